@@ -6,15 +6,20 @@
 #include "actor.h"
 #include "data.h"
 
+int camera_x, camera_y;
+
 void draw_meta_sprite(int x, int y, int w, int h, unsigned char tile) {
 	static char i, j;
 	static int sx, sy;
-	static unsigned char st;
+	
+	/* Nothing to clip piece by piece if the whole actor is off screen */
+	if (x >= SCREEN_W || y >= SCREEN_H || x + (w << 3) <= 0 || y + (h << 4) <= 0) {
+		return;
+	}
 	
 	sy = y;
-	st = tile;
 	for (i = h; i; i--) {
-		if (y >= 0 && y < SCREEN_H) {
+		if (sy >= 0 && sy < SCREEN_H) {
 			sx = x;
 			for (j = w; j; j--) {
 				if (sx >= 0 && sx < SCREEN_W) {
@@ -23,6 +28,8 @@ void draw_meta_sprite(int x, int y, int w, int h, unsigned char tile) {
 				sx += 8;
 				tile += 2;
 			}
+		} else {
+			tile += w << 1;
 		}
 		sy += 16;
 	}
@@ -52,9 +59,12 @@ void init_actor(actor *act, int x, int y, int char_w, int char_h, unsigned char
 	sa->frame_increment = char_w * (char_h << 1);
 	sa->frame_max = sa->frame_increment * frame_count;
 
-	sa->path_flags = 0;
-	sa->path = 0;
-	sa->curr_step = 0;
+	sa->spd_x.w = 0;
+	sa->spd_y.w = 0;
+	sa->sub_x = 0;
+	sa->sub_y = 0;
+	
+	set_actor_path(sa, 0, 0, FIXED(1));
 	
 	sa->col_w = sa->pixel_w - 4;
 	sa->col_h = sa->pixel_h - 4;
@@ -65,9 +75,35 @@ void init_actor(actor *act, int x, int y, int char_w, int char_h, unsigned char
 	sa->state_timer = 256;
 }
 
+void set_actor_path(actor *act, const unsigned char *path, char path_flags, int path_speed) {
+	act->path_flags = path_flags;
+	act->path_speed.w = path_speed;
+	act->path_phase = 0;
+	act->path = path;
+	act->curr_step = path;
+	act->step_remaining = path ? path[1] : 0;
+}
+
+/* Returns the delta of the next step, moving on to the next segment when the current one runs out */
+unsigned char next_path_delta(const unsigned char *path, const unsigned char **step, unsigned char *remaining) {
+	static const unsigned char *segment;
+	
+	segment = *step;
+	if (!*remaining) {
+		segment += 2;
+		if (!segment[1]) segment = path;
+		*step = segment;
+		*remaining = segment[1];
+	}
+	
+	(*remaining)--;
+	return segment[0];
+}
+
 void move_actor(actor *_act) {
 	static actor *act;
-	static path_step *step, *curr_step;
+	static unsigned char steps, delta;
+	static unsigned int sum;
 	static char path_flags;
 	
 	if (!_act->active) {
@@ -77,35 +113,40 @@ void move_actor(actor *_act) {
 	act = _act;
 	
 	if (act->path) {
-		curr_step = act->curr_step;
-		
-		if (!curr_step) curr_step = act->path;
-		step = curr_step++;
-		if (step->x == -128) step = curr_step = act->path;
+		/* Whole steps this frame; the fraction carries over to the next ones */
+		sum = act->path_phase + act->path_speed.b.l;
+		steps = act->path_speed.b.h + (unsigned char) (sum >> 8);
+		act->path_phase = sum;
 		
 		path_flags = act->path_flags;
-		act->x += (path_flags & PATH_FLIP_X) ? -step->x : step->x;
-		act->y += (path_flags & PATH_FLIP_Y) ? -step->y : step->y;
-		
-		if (path_flags & PATH_2X_SPEED) {
-			step = curr_step++;
-			if (step->x == -128) step = curr_step = act->path;
-			
-			path_flags = act->path_flags;
-			act->x += (path_flags & PATH_FLIP_X) ? -step->x : step->x;
-			act->y += (path_flags & PATH_FLIP_Y) ? -step->y : step->y;
+		for (; steps; steps--) {
+			delta = next_path_delta(act->path, &act->curr_step, &act->step_remaining);
+			act->x += (path_flags & PATH_FLIP_X) ? -PATH_DELTA_X(delta) : PATH_DELTA_X(delta);
+			act->y += (path_flags & PATH_FLIP_Y) ? -PATH_DELTA_Y(delta) : PATH_DELTA_Y(delta);
 		}
-
-		act->curr_step = curr_step;
 	}
 
-	if (_act->spd_x) {
-		_act->x += _act->spd_x;
+	if (act->spd_x.w) {
+		sum = act->sub_x + act->spd_x.b.l;
+		act->x += act->spd_x.b.h + (unsigned char) (sum >> 8);
+		act->sub_x = sum;
+		
+		if (act->spd_x.w < 0) {
+			if (act->x + act->pixel_w < 0) act->active = 0;
+		} else {
+			if (act->x >= SCREEN_W) act->active = 0;
+		}				
+	}
+	
+	if (act->spd_y.w) {
+		sum = act->sub_y + act->spd_y.b.l;
+		act->y += act->spd_y.b.h + (unsigned char) (sum >> 8);
+		act->sub_y = sum;
 		
-		if (_act->spd_x < 0) {
-			if (_act->x + _act->pixel_w < 0) _act->active = 0;
+		if (act->spd_y.w < 0) {
+			if (act->y + act->pixel_h < 0) act->active = 0;
 		} else {
-			if (_act->x >= SCREEN_W) _act->active = 0;
+			if (act->y >= SCREEN_H) act->active = 0;
 		}				
 	}
 	
@@ -128,7 +169,7 @@ void draw_actor(actor *act) {
 		frame_tile += _act->frame_max;
 	}
 	
-	draw_meta_sprite(_act->x, _act->y, _act->char_w, _act->char_h, frame_tile);	
+	draw_meta_sprite(_act->x - camera_x, _act->y - camera_y, _act->char_w, _act->char_h, frame_tile);
 
 	if (_act->animation_delay) {
 		_act->animation_delay--;
@@ -10,7 +10,6 @@
 
 #define PATH_FLIP_X (0x01)
 #define PATH_FLIP_Y (0x02)
-#define PATH_2X_SPEED (0x04)
 
 
 typedef union _fixed {
@@ -21,22 +20,27 @@ typedef union _fixed {
   int w;
 } fixed;
 
-typedef struct _path_step {
-	signed char x, y;
-} path_step;
+/* 8.8 fixed point constant, e.g. FIXED(1.5) */
+#define FIXED(n) ((int) ((n) * 256))
 
-typedef struct _path {
-	signed char x, y;
-	char flags;
-	path_step *steps;
-} path;
+/*
+ * Paths are streams of 2 byte segments: a delta, with x on the high nibble and y on the low one
+ * (both signed, -8 to 7 pixels), then the number of steps that repeat it, from 1 to 255.
+ * A count of 0 ends the path, which then starts over; a path must have at least one segment.
+ */
+#define PATH_DELTA(x, y) ((((x) & 0x0F) << 4) | ((y) & 0x0F))
+#define PATH_DELTA_X(delta) ((signed char) (delta) >> 4)
+#define PATH_DELTA_Y(delta) ((signed char) ((delta) << 4) >> 4)
+#define PATH_END 0, 0
 
 typedef struct actor {
 	char active;
 	
 	int x, y;
 	
-	int spd_x;
+	/* Linear movement, in pixels per frame; the fractions build up on sub_x and sub_y */
+	fixed spd_x, spd_y;
+	unsigned char sub_x, sub_y;
 	char facing_left;
 	
 	char char_w, char_h;
@@ -46,8 +50,12 @@ typedef struct actor {
 	unsigned char base_tile, frame_count;
 	unsigned char frame, frame_increment, frame_max;
 	
+	/* Path movement, in steps per frame */
 	char path_flags;
-	path_step *path, *curr_step;
+	fixed path_speed;
+	unsigned char path_phase;
+	const unsigned char *path, *curr_step;
+	unsigned char step_remaining;
 	
 	unsigned char state;
 	int state_timer;
@@ -58,8 +66,13 @@ typedef struct actor {
 	unsigned int score;
 } actor;
 
+/* Top left corner of the screen, on the same coordinates as the actors */
+extern int camera_x, camera_y;
+
 void draw_meta_sprite(int x, int y, int w, int h, unsigned char tile);
 void init_actor(actor *act, int x, int y, int char_w, int char_h, unsigned char base_tile, unsigned char frame_count);
+void set_actor_path(actor *act, const unsigned char *path, char path_flags, int path_speed);
+unsigned char next_path_delta(const unsigned char *path, const unsigned char **step, unsigned char *remaining);
 void move_actor(actor *act);
 void draw_actor(actor *act);
 
@@ -0,0 +1,78 @@
+#include "lib/SMSlib.h"
+#include "lib/PSGlib.h"
+#include "audio.h"
+#include "profiler.h"
+
+/* Pages holding the current song and effect; 0 when there's nothing to play */
+unsigned char audio_music_page, audio_sfx_page;
+
+/* Set while a song or effect is being started, so that the tick never sees it half done; it just skips that frame */
+volatile unsigned char audio_busy;
+
+#ifdef PROFILER
+volatile unsigned char audio_tick_lines;
+#endif
+
+void audio_tick() {
+	static unsigned char saved_page;
+#ifdef PROFILER
+	static unsigned char start_line;
+	start_line = SMS_getVCount();
+#endif
+
+	if (audio_busy) return;
+
+	/* Writes to the mapper registers also go to RAM, so the page being replaced can be read back */
+	saved_page = ROM_bank_to_be_mapped_on_slot2;
+
+	if (audio_music_page) {
+		SMS_mapROMBank(audio_music_page);
+		PSGFrame();
+	}
+
+	if (audio_sfx_page) {
+		SMS_mapROMBank(audio_sfx_page);
+		PSGSFXFrame();
+		if (PSGSFXGetStatus() == PSG_STOPPED) audio_sfx_page = 0;
+	}
+
+	SMS_mapROMBank(saved_page);
+
+#ifdef PROFILER
+	audio_tick_lines = profiler_elapsed_lines(start_line, SMS_getVCount());
+#endif
+}
+
+void audio_init() {
+	audio_busy = 1;
+	PSGStop();
+	PSGSFXStop();
+	audio_music_page = 0;
+	audio_sfx_page = 0;
+	audio_busy = 0;
+
+	SMS_setLineInterruptHandler(audio_tick);
+	SMS_setLineCounter(AUDIO_TICK_LINE);
+	SMS_enableLineInterrupt();
+}
+
+void audio_play_music(unsigned char page, void *song) {
+	audio_busy = 1;
+	PSGPlay(song);
+	audio_music_page = page;
+	audio_busy = 0;
+}
+
+void audio_stop_music() {
+	audio_busy = 1;
+	PSGStop();
+	audio_music_page = 0;
+	audio_busy = 0;
+}
+
+void audio_play_sfx(unsigned char page, void *sfx, unsigned char channels) {
+	audio_busy = 1;
+	PSGSFXPlay(sfx, channels);
+	audio_sfx_page = page;
+	audio_busy = 0;
+}
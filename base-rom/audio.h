@@ -0,0 +1,41 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+/*
+ * Music and sound effects, played by PSGlib straight from the resource pages.
+ *
+ * PSGFrame() and PSGSFXFrame() are called from the line interrupt, raised once per frame at the last
+ * line of the active display, right as VBlank starts; that keeps the tempo steady even while a level
+ * is loading. The tick maps the page of each song into slot 2, and maps back whatever page was there
+ * before it returns, so the main code never notices.
+ *
+ * Songs and effects must fit in a single page, since PSGlib can't follow its data across a page boundary;
+ * the resource packer only splits files that are bigger than a page.
+ */
+
+/* The last line of the active display; the line counter is reloaded on every line outside of it, so this fires once per frame */
+#define AUDIO_TICK_LINE (191)
+
+/* For audio_play_sfx(); same as PSGlib's SFX_CHANNEL*, which can only be used from assembly */
+#define AUDIO_SFX_CHANNEL2 (0x01)
+#define AUDIO_SFX_CHANNEL3 (0x02)
+#define AUDIO_SFX_CHANNELS2AND3 (AUDIO_SFX_CHANNEL2 | AUDIO_SFX_CHANNEL3)
+
+/* Installs the tick on the line interrupt, and enables it; to be called once, at startup */
+void audio_init();
+
+/* The song is looped; page is where it's stored, and song points to it on slot 2 */
+void audio_play_music(unsigned char page, void *song);
+void audio_stop_music();
+
+void audio_play_sfx(unsigned char page, void *sfx, unsigned char channels);
+
+/* The line interrupt handler; only to be called directly for benchmarks */
+void audio_tick();
+
+#ifdef PROFILER
+/* Scanlines taken by the last tick; measured from inside the interrupt, so it can't touch the profiler itself */
+extern volatile unsigned char audio_tick_lines;
+#endif
+
+#endif /* AUDIO_H */
@@ -0,0 +1,3 @@
+/* Stand-in for the folder2c-generated data.h, for host builds */
+extern const unsigned char font_1bpp[];
+#define font_1bpp_size (2048)
@@ -0,0 +1,422 @@
+/*
+ * Native build of the base ROM's game logic, for benchmarks and regression checks.
+ *
+ * Usage: puzzle_maker_host <file.resource.bin> [script] [move count]
+ *
+ * Each script line has a level number, a sequence of moves (U, D, L, R, or Z/Y for undo/redo) and, optionally,
+ * the expected hash of the final state; lines without a hash get theirs printed, so they can be
+ * used as golden values. Without a script, a fixed pseudo-random sequence is used on every level.
+ * After each line, the visible part of the name table is also checked against the map, taking the
+ * scroll registers into account.
+ */
+
+#include "host_rom.h"
+
+#define MAX_SCRIPT_LINES (4096)
+#define MAX_SCRIPT_MOVES (1024)
+#define DEFAULT_MOVE_COUNT (1000000L)
+
+typedef struct script_line {
+	int level;
+	char moves[MAX_SCRIPT_MOVES];
+	int has_expected_hash;
+	uint32_t expected_hash;
+} script_line;
+
+script_line script[MAX_SCRIPT_LINES];
+int script_line_count;
+
+void load_script(const char *file_name) {
+	FILE *f = fopen(file_name, "r");
+	if (!f) {
+		perror(file_name);
+		exit(2);
+	}
+	
+	char line[MAX_SCRIPT_MOVES + 64];
+	while (script_line_count < MAX_SCRIPT_LINES && fgets(line, sizeof(line), f)) {
+		script_line *sl = script + script_line_count;
+		unsigned int hash;
+		int fields = sscanf(line, "%d %1023s %x", &sl->level, sl->moves, &hash);
+		if (fields < 2) continue;
+		
+		sl->has_expected_hash = fields == 3;
+		sl->expected_hash = hash;
+		script_line_count++;
+	}
+	fclose(f);
+}
+
+void generate_default_script() {
+	uint32_t seed = 12345;
+	for (int level = 1; level <= resource_header->level_count && script_line_count < MAX_SCRIPT_LINES; level++) {
+		script_line *sl = script + script_line_count;
+		sl->level = level;
+		for (int i = 0; i != 64; i++) {
+			seed = seed * 1103515245 + 12345;
+			sl->moves[i] = "UDLR"[(seed >> 16) & 3];
+		}
+		sl->moves[64] = 0;
+		sl->has_expected_hash = 0;
+		script_line_count++;
+	}
+}
+
+/* The floor only matters under pushable tiles, as what they leave behind; empty and tile 1 are the same there */
+unsigned char visible_floor_tile(int cell_number) {
+	unsigned char floor_tile = read_floor_tile(cell_number);
+	if (floor_tile < 2 || !(get_tile_attr(map_data[cell_number]) & TILE_ATTR_PUSHABLE)) return 0;
+	return floor_tile;
+}
+
+/* FNV-1a over the map, the floor and the player position */
+uint32_t state_hash(resource_map_format *map) {
+	uint32_t hash = 2166136261u;
+	int size = map->width * map->height;
+	
+	for (int i = 0; i != size; i++) hash = (hash ^ (unsigned char) map_data[i]) * 16777619u;
+	for (int i = 0; i != size; i++) hash = (hash ^ visible_floor_tile(i)) * 16777619u;
+	hash = (hash ^ get_actor_map_x(&player)) * 16777619u;
+	hash = (hash ^ get_actor_map_y(&player)) * 16777619u;
+	hash = (hash ^ stage_clear) * 16777619u;
+	
+	return hash;
+}
+
+/* The name table entry for the top left of a metatile, read straight from the resource image */
+unsigned int expected_name_entry(resource_location_format *metatiles, int tile) {
+	/* Without a metatile table, each metatile has 4 tiles of its own */
+	if (!metatiles) return tile << 2;
+	
+	unsigned char *table = host_rom + metatiles->page * HOST_PAGE_SIZE + metatiles->offset;
+	if (tile >= (table[0] | table[1] << 8)) return 0;
+	
+	unsigned char *entry = table + 2 + tile * 8;
+	return entry[0] | entry[1] << 8;
+}
+
+/* Frames that the queue is given to empty itself before the check gives up */
+#define MAX_DRAIN_FRAMES (1000)
+
+/* Compares what the VDP would display against the map, once the queue is empty; returns the number of wrong cells */
+int check_screen(resource_map_format *map) {
+	int errors = 0;
+	
+	for (int frames = 0; vram_queue_count; frames++) {
+		if (frames == MAX_DRAIN_FRAMES) {
+			fprintf(stdout, "FAIL: the VRAM queue is still holding %d command(s) after %d frames\n", vram_queue_count, frames);
+			return VIEW_CELL_W * VIEW_CELL_H;
+		}
+		vram_queue_drain();
+		update_scroll();
+	}
+	resource_location_format *metatiles = resource_find("main.mtl");
+	
+	for (int row = 0; row != VIEW_CELL_H; row++) {
+		int map_y = camera_cell_y + row;
+		if (map_y < 0) continue; /* HUD */
+		
+		for (int col = 0; col != VIEW_CELL_W; col++) {
+			int map_x = camera_cell_x + col;
+			int tile = map_x < map->width && map_y < map->height ? (unsigned char) get_map_tile(map, map_x, map_y) : 0;
+			
+			int name_x = ((col * 16 - host_vdp.scroll_x) & 0xFF) >> 3;
+			int name_y = ((row * 16 + host_vdp.scroll_y) % (SCROLL_CHAR_H * 8)) >> 3;
+			unsigned char *entry = host_vram + 0x3800 + (name_y * SCREEN_CHAR_W + name_x) * 2;
+			
+			if ((unsigned int) (entry[0] | entry[1] << 8) != expected_name_entry(metatiles, tile)) errors++;
+		}
+	}
+	
+	return errors;
+}
+
+int check_golden_states() {
+	int failures = 0;
+	
+	for (int i = 0; i != script_line_count; i++) {
+		script_line *sl = script + i;
+		resource_map_format *map = start_level(sl->level);
+		if (!map) {
+			fprintf(stderr, "Level %d not found\n", sl->level);
+			failures++;
+			continue;
+		}
+		
+		/* Drawing may map other pages, but it has to leave the level's page in place */
+		unsigned char level_page = ROM_bank_to_be_mapped_on_slot2;
+		draw_level(map);
+		for (char *move = sl->moves; *move; move++) apply_move(map, *move);
+		if (ROM_bank_to_be_mapped_on_slot2 != level_page) {
+			fprintf(stdout, "FAIL: level %d: page %d is mapped after the moves, instead of %d\n", sl->level, ROM_bank_to_be_mapped_on_slot2, level_page);
+			failures++;
+		}
+		
+		int screen_errors = check_screen(map);
+		if (screen_errors) {
+			fprintf(stdout, "FAIL: level %d: %d cell(s) wrong on screen\n", sl->level, screen_errors);
+			failures++;
+		}
+		
+		uint32_t hash = state_hash(map);
+		if (!sl->has_expected_hash) {
+			fprintf(stdout, "%d %s %08x\n", sl->level, sl->moves, hash);
+		} else if (hash != sl->expected_hash) {
+			fprintf(stdout, "FAIL: level %d: expected %08x, got %08x\n", sl->level, sl->expected_hash, hash);
+			failures++;
+		}
+	}
+	
+	return failures;
+}
+
+/* Plays the script again with a budget below the minimum; every command must still get through, one frame at a time */
+int check_low_budget() {
+	int failures = 0;
+	
+	vram_queue_budget = 1;
+	for (int i = 0; i != script_line_count; i++) {
+		script_line *sl = script + i;
+		resource_map_format *map = start_level(sl->level);
+		if (!map) continue;
+		
+		draw_level(map);
+		for (char *move = sl->moves; *move; move++) apply_move(map, *move);
+		
+		int screen_errors = check_screen(map);
+		if (screen_errors) {
+			fprintf(stdout, "FAIL: level %d, lowest VRAM budget: %d cell(s) wrong on screen\n", sl->level, screen_errors);
+			failures++;
+		}
+	}
+	vram_queue_budget = VRAM_QUEUE_DEFAULT_BUDGET;
+	
+	return failures;
+}
+
+void report(const char *name, long count, double elapsed, unsigned long vram_bytes) {
+	fprintf(stdout, "%-32s %12.0f/s  %8.1f ns/op  %8.1f VRAM bytes/op\n", 
+		name, count / elapsed, elapsed * 1e9 / count, (double) vram_bytes / count);
+}
+
+void benchmark_moves(long move_count) {
+	long moves = 0;
+	unsigned long vram_before = host_vdp.vram_bytes;
+	double start = now_seconds();
+	
+	while (moves < move_count) {
+		for (int i = 0; i != script_line_count && moves < move_count; i++) {
+			resource_map_format *map = start_level(script[i].level);
+			if (!map) continue;
+			
+			for (char *move = script[i].moves; *move; move++) {
+				apply_move(map, *move);
+				moves++;
+			}
+		}
+	}
+	
+	report("scripted moves", moves, now_seconds() - start, host_vdp.vram_bytes - vram_before);
+}
+
+void benchmark_resource_find(long count) {
+	static char *names[] = { "main.pal", "main.atr", "merging.dat", "project.inf", "missing.dat" };
+	double start = now_seconds();
+	
+	for (long i = 0; i != count; i++) resource_find(names[i % 5]);
+	
+	report("resource_find", count, now_seconds() - start, 0);
+}
+
+void benchmark_draw_map(long count) {
+	resource_map_format *map = start_level(1);
+	if (!map) return;
+	
+	unsigned long vram_before = host_vdp.vram_bytes;
+	double start = now_seconds();
+	
+	for (long i = 0; i != count; i++) {
+		draw_map(map);
+		while (vram_queue_count) vram_queue_drain();
+	}
+	
+	report("draw_map", count, now_seconds() - start, host_vdp.vram_bytes - vram_before);
+}
+
+/* What it takes to go to the next level, with and without reloading the shared assets */
+void benchmark_level_transition(long count) {
+	resource_map_format *map = start_level(1);
+	if (!map) return;
+	
+	unsigned long vram_before = host_vdp.vram_bytes;
+	double start = now_seconds();
+	
+	for (long i = 0; i != count; i++) {
+		initialize_graphics();
+		load_tileset();
+		draw_level(map);
+	}
+	
+	report("full level setup", count, now_seconds() - start, host_vdp.vram_bytes - vram_before);
+	
+	vram_before = host_vdp.vram_bytes;
+	start = now_seconds();
+	
+	for (long i = 0; i != count; i++) draw_level(map);
+	
+	report("level transition", count, now_seconds() - start, host_vdp.vram_bytes - vram_before);
+}
+
+void benchmark_move_actor(long count) {
+	static const unsigned char steps[] = { PATH_DELTA(1, 0), 2, PATH_DELTA(0, 1), 1, PATH_DELTA(-1, 0), 2, PATH_DELTA(0, -1), 1, PATH_END };
+	actor act;
+	
+	init_actor(&act, 32, 32, 2, 1, 8, 2);
+	set_actor_path(&act, steps, 0, FIXED(1.5));
+	
+	double start = now_seconds();
+	for (long i = 0; i != count; i++) move_actor(&act);
+	
+	report("move_actor", count, now_seconds() - start, 0);
+}
+
+/* Sprite submission for a 16x16 actor */
+void benchmark_draw_actor(long count) {
+	actor act;
+	
+	init_actor(&act, 32, 32, 2, 1, 8, 2);
+	
+	unsigned long sprites_before = host_vdp.sprites;
+	double start = now_seconds();
+	for (long j = 0; j != count; j++) {
+		if (!(j & 15)) SMS_initSprites();
+		
+		/* Mostly on screen, sometimes partially or completely off it */
+		act.x = (j * 37) % (SCREEN_W + 64) - 32;
+		act.y = (j * 23) % (SCREEN_H + 64) - 32;
+		draw_actor(&act);
+	}
+	
+	report("draw_actor", count, now_seconds() - start, 0);
+	fprintf(stdout, "%-32s %12.2f sprites/op\n", "", (double) (host_vdp.sprites - sprites_before) / count);
+}
+
+/* Feeds the pad one frame at a time, the way the gameplay loop reads it, and checks which action comes out on each frame */
+int check_input_sequence(const char *name, const unsigned short *keys, const unsigned char *expected, int frame_count) {
+	int failures = 0;
+	
+	host_keys = 0;
+	SMS_waitForVBlank();
+	input_clear();
+	
+	for (int f = 0; f != frame_count; f++) {
+		host_keys = keys[f];
+		SMS_waitForVBlank();
+		input_update();
+		
+		unsigned char action = input_next_action();
+		if (action != expected[f]) {
+			fprintf(stdout, "FAIL: input %s, frame %d: got action %d instead of %d\n", name, f, action == INPUT_NONE ? -1 : action, expected[f] == INPUT_NONE ? -1 : expected[f]);
+			failures++;
+		}
+	}
+	
+	return failures;
+}
+
+int check_input() {
+	enum { N = INPUT_NONE, U = INPUT_UP, R = INPUT_RIGHT, Z = INPUT_UNDO };
+	enum { KU = PORT_A_KEY_UP, KR = PORT_A_KEY_RIGHT, K1 = PORT_A_KEY_1 };
+	int failures = 0;
+	
+	/* Taps on consecutive frames, and two keys pressed together: each one is a move, on the frame it happens or right after */
+	static const unsigned short taps[] = { KR, 0, KR, KU, 0, KR | KU, 0, K1, 0 };
+	static const unsigned char taps_expected[] = { R, N, R, U, N, U, R, Z, N };
+	failures += check_input_sequence("taps", taps, taps_expected, sizeof(taps_expected));
+	
+	/* Holding a key repeats it after INPUT_DAS frames, then every INPUT_ARR frames */
+	unsigned short hold[INPUT_DAS + INPUT_ARR * 2 + 2];
+	unsigned char hold_expected[sizeof(hold) / sizeof(*hold)];
+	int frame_count = sizeof(hold_expected);
+	for (int f = 0; f != frame_count; f++) {
+		hold[f] = f == frame_count - 1 ? 0 : KR;
+		hold_expected[f] = (f == 0 || (f >= INPUT_DAS && f != frame_count - 1 && !((f - INPUT_DAS) % INPUT_ARR))) ? R : N;
+	}
+	failures += check_input_sequence("hold", hold, hold_expected, frame_count);
+	
+	return failures;
+}
+
+/* The audio tick runs from the line interrupt, at any point of the game's code, so it must always map back the game's page */
+int check_audio() {
+	enum { MUSIC_PAGE = HOST_MAX_PAGES - 1, SFX_PAGE = HOST_MAX_PAGES - 2, FRAME_COUNT = HOST_SFX_FRAMES * 2 };
+	int failures = 0;
+	
+	memset(&host_psg, 0, sizeof(host_psg));
+	audio_init();
+	
+	SMS_mapROMBank(MUSIC_PAGE);
+	audio_play_music(MUSIC_PAGE, RESOURCE_BASE_ADDR + 0x100);
+	SMS_mapROMBank(SFX_PAGE);
+	audio_play_sfx(SFX_PAGE, RESOURCE_BASE_ADDR + 0x200, AUDIO_SFX_CHANNELS2AND3);
+	
+	SMS_mapROMBank(RESOURCE_BANK);
+	for (int f = 0; f != FRAME_COUNT; f++) {
+		SMS_waitForVBlank();
+		if (ROM_bank_to_be_mapped_on_slot2 != RESOURCE_BANK) {
+			fprintf(stdout, "FAIL: audio, frame %d: page %d left mapped instead of %d\n", f, ROM_bank_to_be_mapped_on_slot2, RESOURCE_BANK);
+			failures++;
+			SMS_mapROMBank(RESOURCE_BANK);
+		}
+	}
+	
+	if (host_psg.music_frames != FRAME_COUNT || host_psg.sfx_frames != HOST_SFX_FRAMES || host_psg.wrong_page_frames) {
+		fprintf(stdout, "FAIL: audio: %lu music and %lu effect frames, %lu on the wrong page; expected %d, %d and 0\n", 
+			host_psg.music_frames, host_psg.sfx_frames, host_psg.wrong_page_frames, FRAME_COUNT, HOST_SFX_FRAMES);
+		failures++;
+	}
+	
+	audio_stop_music();
+	SMS_disableLineInterrupt();
+	
+	return failures;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <file.resource.bin> [script] [move count]\n", argv[0]);
+		return 2;
+	}
+	
+	load_resource_file(argv[1]);
+	if (argc > 2 && strcmp(argv[2], "-")) {
+		load_script(argv[2]);
+	} else {
+		generate_default_script();
+	}
+	long move_count = argc > 3 ? atol(argv[3]) : DEFAULT_MOVE_COUNT;
+	
+	vram_queue_init();
+	
+	/* The metatile table comes with the tileset, as on the ROM */
+	load_tileset();
+	
+	int failures = check_golden_states();
+	failures += check_low_budget();
+	failures += check_input();
+	failures += check_audio();
+	
+	benchmark_moves(move_count);
+	benchmark_resource_find(move_count);
+	benchmark_draw_map(move_count / 100);
+	benchmark_level_transition(move_count / 1000);
+	benchmark_move_actor(move_count);
+	benchmark_draw_actor(move_count);
+	
+	if (failures) {
+		fprintf(stdout, "%d check failure(s)\n", failures);
+		return 1;
+	}
+	
+	return 0;
+}
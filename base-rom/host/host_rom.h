@@ -0,0 +1,83 @@
+#ifndef HOST_ROM_H
+#define HOST_ROM_H
+
+/*
+ * Unity build of the base ROM sources, with the helpers the host programs share;
+ * must be included once, by the file that has main().
+ */
+
+#include "host_sms.h"
+
+/* SDCC's int is 16 bits wide, and the resource formats depend on that; only the ROM sources see it that way */
+#define int short
+#define main rom_main
+#include "../actor.c"
+#include "../vram_queue.c"
+#include "../profiler.c"
+#include "../undo.c"
+#include "../input.c"
+#include "../audio.c"
+#include "../puzzle_maker_base_rom.c"
+#undef main
+#undef int
+
+double now_seconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void load_resource_file(const char *file_name) {
+	FILE *f = fopen(file_name, "rb");
+	if (!f) {
+		perror(file_name);
+		exit(2);
+	}
+	
+	/* The resource pages start at RESOURCE_BANK */
+	fread(host_rom + RESOURCE_BANK * HOST_PAGE_SIZE, 1, sizeof(host_rom) - RESOURCE_BANK * HOST_PAGE_SIZE, f);
+	fclose(f);
+	
+	SMS_mapROMBank(RESOURCE_BANK);
+	if (!is_resource_format_supported()) {
+		fprintf(stderr, "%s: not a resource file of format %d\n", file_name, RESOURCE_FORMAT_VERSION);
+		exit(2);
+	}
+}
+
+resource_map_format *start_level(int level) {
+	load_tile_attrs();
+	load_tile_combinations();
+	
+	resource_map_format *map = load_map(level);
+	if (!map) return 0;
+	
+	prepare_map_data(map);
+	init_actor(&player, 32, 32, 2, 1, 8, 2);
+	player_find_start(map);
+	init_camera(map);
+	stage_clear = 0;
+	clear_map_changes();
+	undo_clear();
+	
+	return map;
+}
+
+/* Same as the gameplay loop does for each move */
+void apply_move(resource_map_format *map, char move) {
+	switch (move) {
+	case 'U': try_moving_actor_on_map(&player, map, 0, -1); break;
+	case 'D': try_moving_actor_on_map(&player, map, 0, 1); break;
+	case 'L': try_moving_actor_on_map(&player, map, -1, 0); break;
+	case 'R': try_moving_actor_on_map(&player, map, 1, 0); break;
+	case 'Z': undo_actor_move(&player, map); break;
+	case 'Y': redo_actor_move(&player, map); break;
+	}
+	
+	move_camera(map);
+	draw_map_changes(map);
+	vram_queue_drain();
+	update_scroll();
+}
+
+#endif /* HOST_ROM_H */
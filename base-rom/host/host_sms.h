@@ -0,0 +1,64 @@
+#ifndef HOST_SMS_H
+#define HOST_SMS_H
+
+/*
+ * Lets the base ROM sources compile natively with gcc/clang, against the stub SMSlib in smslib_stub.c.
+ * Must be included before any of the ROM sources; it brings in every system header they use, so that
+ * none of them gets compiled with the ROM's 16 bit int.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <time.h>
+
+/* SDCC-specific keywords */
+#define __z88dk_fastcall
+#define __naked
+#define __preserves_regs(...)
+#define __at(addr)
+
+/* The ROM prints through SMSlib's text renderer, not stdout. */
+#define printf host_printf
+#define puts host_puts
+void host_printf(const char *format, ...);
+void host_puts(const char *s);
+
+/* Slot 2 shows the currently mapped page of the ROM image */
+#define HOST_PAGE_SIZE (0x4000L)
+#define HOST_MAX_PAGES (256)
+extern unsigned char host_rom[HOST_PAGE_SIZE * HOST_MAX_PAGES];
+#define RESOURCE_BASE_ADDR (host_rom + ROM_bank_to_be_mapped_on_slot2 * HOST_PAGE_SIZE)
+
+/* SMSlib.h declares this without a size, which is only fine for SDCC's __at */
+extern unsigned char SMS_SRAM[0x4000];
+
+/* What the stub VDP has seen */
+typedef struct host_vdp_stats {
+	unsigned long vram_bytes;
+	unsigned long cram_bytes;
+	unsigned long address_setups;
+	unsigned long frames;
+	unsigned long sprites;
+	unsigned char scroll_x, scroll_y;
+} host_vdp_stats;
+
+/* What the stub PSGlib has seen; its sound effects last for HOST_SFX_FRAMES frames */
+#define HOST_SFX_FRAMES (8)
+
+typedef struct host_psg_stats {
+	unsigned long music_frames;
+	unsigned long sfx_frames;
+	
+	/* Frames ticked while the song or effect wasn't on the page mapped into slot 2 */
+	unsigned long wrong_page_frames;
+} host_psg_stats;
+
+extern unsigned char host_vram[0x4000];
+extern host_vdp_stats host_vdp;
+extern host_psg_stats host_psg;
+extern unsigned short host_keys;
+
+#endif /* HOST_SMS_H */
@@ -0,0 +1,309 @@
+#include "host_sms.h"
+
+/* Same as on the ROM sources, so that the stubs match the prototypes they're called through */
+#define int short
+#include "../lib/SMSlib.h"
+#include "../lib/PSGlib.h"
+#include "data.h"
+
+/*
+ * Stub SMSlib for host builds: VDP writes are recorded on host_vram and host_vdp, not displayed.
+ * Note that int is 16 bits wide in here, just like on SDCC.
+ */
+
+#define HOST_MAX_SPRITES (64)
+
+unsigned char host_rom[HOST_PAGE_SIZE * HOST_MAX_PAGES];
+unsigned char host_vram[0x4000];
+unsigned char host_cram[32];
+host_vdp_stats host_vdp;
+host_psg_stats host_psg;
+unsigned short host_keys;
+
+/* Latched on each VBlank, like the SMSlib interrupt handler does */
+static unsigned short keys_status, previous_keys_status;
+
+const unsigned char font_1bpp[font_1bpp_size];
+
+volatile unsigned char ROM_bank_to_be_mapped_on_slot2;
+volatile unsigned char SRAM_bank_to_be_mapped_on_slot2;
+
+static unsigned short vdp_addr;
+static char vdp_writing_cram;
+static unsigned char sprite_count;
+static signed short text_offset;
+
+/* Same as SMS_enableLineInterrupt(): IE1, on register 0 */
+#define LINE_INTERRUPT_FEATURE (0x0010)
+static void (*line_interrupt_handler)(void);
+static char line_interrupt_enabled;
+
+static void vdp_write_byte(unsigned char value) {
+	if (vdp_writing_cram) {
+		host_cram[vdp_addr & 0x1F] = value;
+		host_vdp.cram_bytes++;
+	} else {
+		host_vram[vdp_addr & 0x3FFF] = value;
+		host_vdp.vram_bytes++;
+	}
+	vdp_addr++;
+}
+
+void SMS_crt0_RST08(unsigned int addr) {
+	host_vdp.address_setups++;
+	vdp_writing_cram = (addr & 0xC000) == 0xC000;
+	vdp_addr = addr & 0x3FFF;
+}
+
+void SMS_crt0_RST18(unsigned int tile) {
+	vdp_write_byte(tile & 0xFF);
+	vdp_write_byte(tile >> 8);
+}
+
+void SMS_VDPturnOnFeature(unsigned int feature) {
+	if (feature == LINE_INTERRUPT_FEATURE) line_interrupt_enabled = 1;
+}
+
+void SMS_VDPturnOffFeature(unsigned int feature) {
+	if (feature == LINE_INTERRUPT_FEATURE) line_interrupt_enabled = 0;
+}
+
+void SMS_setLineInterruptHandler(void (*theHandlerFunction)(void)) {
+	line_interrupt_handler = theHandlerFunction;
+}
+
+/* Every frame gets one line interrupt, on its way to VBlank; the line itself doesn't matter here */
+void SMS_setLineCounter(unsigned char count) {
+	(void) count;
+}
+
+void SMS_useFirstHalfTilesforSprites(_Bool usefirsthalf) {
+	(void) usefirsthalf;
+}
+
+void SMS_setSpriteMode(unsigned char mode) {
+	(void) mode;
+}
+
+void SMS_setBGScrollX(unsigned char scrollX) {
+	host_vdp.scroll_x = scrollX;
+}
+
+void SMS_setBGScrollY(unsigned char scrollY) {
+	host_vdp.scroll_y = scrollY;
+}
+void SMS_setBackdropColor(unsigned char entry) {
+	(void) entry;
+}
+
+void SMS_waitForVBlank(void) {
+	if (line_interrupt_enabled && line_interrupt_handler) line_interrupt_handler();
+	
+	host_vdp.frames++;
+	previous_keys_status = keys_status;
+	keys_status = host_keys;
+}
+
+unsigned char SMS_getVCount(void) {
+	return 0;
+}
+
+void SMS_VRAMmemcpy(unsigned int dst, void *src, unsigned int size) {
+	unsigned char *s = src;
+	SMS_crt0_RST08(dst | SMS_VDPVRAMWrite);
+	for (unsigned long i = 0; i != (unsigned short) size; i++) vdp_write_byte(s[i]);
+}
+
+void SMS_VRAMmemset(unsigned int dst, unsigned char value, unsigned int size) {
+	SMS_crt0_RST08(dst | SMS_VDPVRAMWrite);
+	for (unsigned long i = 0; i != (unsigned short) size; i++) vdp_write_byte(value);
+}
+
+void SMS_VRAMmemsetW(unsigned int dst, unsigned int value, unsigned int size) {
+	SMS_crt0_RST08(dst | SMS_VDPVRAMWrite);
+	for (unsigned long i = 0; i != (unsigned short) size; i += 2) SMS_crt0_RST18(value);
+}
+
+void SMS_loadTiles(void *src, unsigned int tilefrom, unsigned int size) {
+	SMS_VRAMmemcpy(tilefrom * 32, src, size);
+}
+
+void SMS_load1bppTiles(void *src, unsigned int tilefrom, unsigned int size, unsigned char color0, unsigned char color1) {
+	(void) src, (void) color0, (void) color1;
+	SMS_VRAMmemset(tilefrom * 32, 0, size * 4);
+}
+
+/*
+ * A tile count, then, for each tile, a byte with 2 bits per bitplane (bitplane 0 on the highest bits) telling
+ * how it's stored: 0, all 0x00; 1, all 0xFF; 2, 8 raw bytes. Method 3 packs repeated rows, but psgaidenCompress()
+ * on game-resource.js never uses it, so it's refused here instead of being decoded.
+ */
+void SMS_loadPSGaidencompressedTilesatAddr(void *src, unsigned int dst) {
+	unsigned char *s = src;
+	unsigned int tile_count = s[0] | s[1] << 8;
+	s += 2;
+	
+	SMS_crt0_RST08(dst | SMS_VDPVRAMWrite);
+	for (unsigned int tile = 0; tile != tile_count; tile++) {
+		unsigned char methods = *s++;
+		unsigned char tile_data[32];
+		
+		for (int plane = 0; plane != 4; plane++) {
+			unsigned char method = (methods >> (6 - plane * 2)) & 0x03;
+			for (int line = 0; line != 8; line++) {
+				switch (method) {
+				case 0: tile_data[line * 4 + plane] = 0x00; break;
+				case 1: tile_data[line * 4 + plane] = 0xFF; break;
+				case 2: tile_data[line * 4 + plane] = *s++; break;
+				default:
+					fprintf(stderr, "PSGaiden tile %d: method 3 isn't supported by the stub\n", tile);
+					exit(2);
+				}
+			}
+		}
+		
+		for (int i = 0; i != 32; i++) vdp_write_byte(tile_data[i]);
+	}
+}
+
+void SMS_loadTileMapArea(unsigned char x, unsigned char y, void *src, unsigned char width, unsigned char height) {
+	unsigned short *s = src;
+	for (unsigned char row = 0; row != height; row++) {
+		SMS_VRAMmemcpy(XYtoADDR(x, y + row), s, width * 2);
+		s += width;
+	}
+}
+
+void SMS_setBGPaletteColor(unsigned char entry, unsigned char color) {
+	SMS_crt0_RST08(SMS_CRAMAddress | entry);
+	vdp_write_byte(color);
+}
+
+void SMS_setSpritePaletteColor(unsigned char entry, unsigned char color) {
+	SMS_crt0_RST08(SMS_CRAMAddress | 0x10 | entry);
+	vdp_write_byte(color);
+}
+
+void SMS_loadBGPalette(void *palette) {
+	unsigned char *p = palette;
+	SMS_crt0_RST08(SMS_CRAMAddress);
+	for (unsigned char i = 0; i != 16; i++) vdp_write_byte(p[i]);
+}
+
+void SMS_loadSpritePalette(void *palette) {
+	unsigned char *p = palette;
+	SMS_crt0_RST08(SMS_CRAMAddress | 0x10);
+	for (unsigned char i = 0; i != 16; i++) vdp_write_byte(p[i]);
+}
+
+void SMS_configureTextRenderer(signed int ascii_to_tile_offset) {
+	text_offset = ascii_to_tile_offset;
+}
+
+void host_puts(const char *s) {
+	for (; *s; s++) SMS_crt0_RST18((unsigned char) *s + text_offset);
+}
+
+void host_printf(const char *format, ...) {
+	char buffer[256];
+	va_list args;
+	
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	
+	host_puts(buffer);
+}
+
+unsigned int SMS_getKeysStatus(void) {
+	return host_keys;
+}
+
+unsigned int SMS_getKeysPressed(void) {
+	return keys_status & ~previous_keys_status;
+}
+
+unsigned int SMS_getKeysHeld(void) {
+	return keys_status & previous_keys_status;
+}
+
+_Bool SMS_queryPauseRequested(void) {
+	return 0;
+}
+
+void SMS_resetPauseRequest(void) {}
+
+void SMS_initSprites(void) {
+	sprite_count = 0;
+}
+
+signed char SMS_addSprite(unsigned char x, unsigned char y, unsigned char tile) {
+	(void) x, (void) tile;
+	if (sprite_count == HOST_MAX_SPRITES) return -1;
+	if (y == 0xD1) return -2;
+	sprite_count++;
+	host_vdp.sprites++;
+	return sprite_count - 1;
+}
+
+void SMS_finalizeSprites(void) {}
+
+void SMS_copySpritestoSAT(void) {
+	SMS_VRAMmemset(0x3F00, 0, 64 + 128);
+}
+
+/*
+ * Stub PSGlib: songs aren't decoded, but every frame checks that the song's data is on the page mapped into slot 2;
+ * sound effects last for HOST_SFX_FRAMES frames.
+ */
+
+static unsigned char *music_data, *sfx_data;
+static unsigned char music_status, sfx_status;
+static unsigned char sfx_frames_left;
+
+static char is_on_mapped_page(unsigned char *data) {
+	return data >= RESOURCE_BASE_ADDR && data < RESOURCE_BASE_ADDR + HOST_PAGE_SIZE;
+}
+
+void PSGPlay(void *song) {
+	music_data = song;
+	music_status = PSG_PLAYING;
+}
+
+void PSGStop(void) {
+	music_status = PSG_STOPPED;
+}
+
+unsigned char PSGGetStatus(void) {
+	return music_status;
+}
+
+void PSGFrame(void) {
+	if (music_status != PSG_PLAYING) return;
+	
+	host_psg.music_frames++;
+	if (!is_on_mapped_page(music_data)) host_psg.wrong_page_frames++;
+}
+
+void PSGSFXPlay(void *sfx, unsigned char channels) {
+	(void) channels;
+	sfx_data = sfx;
+	sfx_status = PSG_PLAYING;
+	sfx_frames_left = HOST_SFX_FRAMES;
+}
+
+void PSGSFXStop(void) {
+	sfx_status = PSG_STOPPED;
+}
+
+unsigned char PSGSFXGetStatus(void) {
+	return sfx_status;
+}
+
+void PSGSFXFrame(void) {
+	if (sfx_status != PSG_PLAYING) return;
+	
+	host_psg.sfx_frames++;
+	if (!is_on_mapped_page(sfx_data)) host_psg.wrong_page_frames++;
+	if (!--sfx_frames_left) sfx_status = PSG_STOPPED;
+}
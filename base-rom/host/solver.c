@@ -0,0 +1,626 @@
+/*
+ * Level solver and solvability checker: finds the shortest solution of each level of a resource pack
+ * with a breadth-first search, spread over several threads.
+ *
+ * Usage: puzzle_maker_solver [-t threads] [-M megabytes] [-m max states] [-s] <file.resource.bin> [first level] [last level]
+ *
+ * Prints, for each level, whether it can be solved, the length of the shortest solution, and how many
+ * states were explored; with -s, the solutions are printed as lines of the host program's script format.
+ * Exits with 1 if any level isn't proven solvable, either because it can't be or because the search
+ * ran out of states.
+ *
+ * The number of states is limited by -M, 256 MB by default: the bytes taken by each state grow with
+ * the size of the level, so the limit is worked out again for each one. -m lowers it further.
+ *
+ * The moves follow the rules of try_moving_actor_on_map() and try_pushing_tile_on_map(), played right
+ * on the packed states, using the ROM's own tile attribute and combination tables. Every
+ * solution is then replayed through the ROM functions themselves, which must clear the level on its
+ * last move.
+ *
+ * States are bit-packed: the player's cell, then the map and floor tiles of the cells that can change,
+ * as indexes on the set of tiles the level can ever hold. Walls that nothing can be merged into are
+ * left out. The transposition table keeps 64 bit Zobrist hashes only, updated incrementally on each
+ * move; two states with the same hash are taken to be the same one.
+ *
+ * Each BFS layer is cut into chunks, dealt out to per-thread deques; a thread that runs out of
+ * chunks steals from the others.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+#include "host_rom.h"
+
+#define SOLVER_MAX_THREADS (64)
+#define SOLVER_DEFAULT_MEMORY_MB (256)
+#define SOLVER_CHUNK_SIZE (256)
+#define SOLVER_NO_NODE (0xFFFFFFFFu)
+
+#define SOLVER_BLOCKED (0)
+#define SOLVER_MOVED (1)
+#define SOLVER_CLEAR (2)
+
+/* Indexed by UNDO_DIR_*, like direction_delta_x/y */
+const char solver_move_names[] = "UDLR";
+
+typedef struct solver_level {
+	int width, height, cell_count;
+	unsigned char initial_map[MAP_MAX_W * MAP_MAX_H];
+	int start_cell;
+
+	/* Tiles the level can ever hold, and their index on that set */
+	int tile_count, tile_bits;
+	unsigned int tile_mask;
+	unsigned char tile_values[MAX_TILE_TYPES];
+	short tile_index[MAX_TILE_TYPES];
+
+	/* Cells that can change, and their index on the packed state, or -1 */
+	int dynamic_count;
+	short dynamic_cells[MAP_MAX_W * MAP_MAX_H];
+	short dynamic_index[MAP_MAX_W * MAP_MAX_H];
+
+	/* Bytes per packed state, and per frontier entry: hash, node, packed state */
+	int state_size, entry_size;
+
+	/* [cell] for the player, [dynamic index][layer][tile index] for the rest */
+	uint64_t *zobrist_player;
+	uint64_t *zobrist_cells;
+} solver_level;
+
+/* A packed state that moves are being played on */
+typedef struct solver_board {
+	unsigned char *state;
+	int player_cell;
+	uint64_t hash;
+} solver_board;
+
+/* Frontier entries; the capacity is in bytes, since the entry size changes from level to level */
+typedef struct solver_buffer {
+	unsigned char *data;
+	size_t count, capacity;
+} solver_buffer;
+
+/* Chunks of the current layer, as a double ended queue; the owner works from the back, thieves from the front */
+typedef struct solver_deque {
+	pthread_mutex_t lock;
+	int *chunks;
+	int front, back;
+} solver_deque;
+
+typedef struct solver_worker {
+	int id;
+	solver_buffer next;
+	unsigned long steals;
+} solver_worker;
+
+solver_level level;
+
+uint64_t *table;
+uint64_t table_mask;
+size_t table_capacity;
+
+uint32_t *node_parent;
+unsigned char *node_move;
+uint32_t node_count, max_states, node_capacity;
+
+/* Limits from the command line; max_states is worked out from them for each level */
+size_t memory_budget;
+uint32_t max_state_limit;
+int out_of_states;
+
+solver_buffer frontier;
+solver_deque deques[SOLVER_MAX_THREADS];
+solver_worker workers[SOLVER_MAX_THREADS];
+int thread_count;
+
+uint32_t solution_node;
+unsigned char solution_move;
+
+uint64_t splitmix64(uint64_t *seed) {
+	uint64_t z = (*seed += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+/* Tiles that no push can ever change: solid, not pushable, and never the target of a combination */
+int is_static_tile(unsigned char tile) {
+	unsigned char attr = get_tile_attr(tile);
+	if (!(attr & TILE_ATTR_SOLID) || (attr & TILE_ATTR_PUSHABLE)) return 0;
+
+	for (int i = 0; i != level.tile_count; i++) {
+		if (get_tile_combination(level.tile_values[i], tile)) return 0;
+	}
+	return 1;
+}
+
+void add_level_tile(unsigned char tile) {
+	if (level.tile_index[tile] >= 0) return;
+	level.tile_index[tile] = level.tile_count;
+	level.tile_values[level.tile_count] = tile;
+	level.tile_count++;
+}
+
+/* Works out the state encoding for the level that start_level() has just loaded */
+void prepare_level(resource_map_format *map) {
+	level.width = map->width;
+	level.height = map->height;
+	level.cell_count = level.width * level.height;
+	memcpy(level.initial_map, map_data, level.cell_count);
+	level.start_cell = get_actor_map_y(&player) * level.width + get_actor_map_x(&player);
+
+	/* 0 is the empty floor, and 1 is what a pushed tile leaves behind */
+	level.tile_count = 0;
+	memset(level.tile_index, 0xFF, sizeof(level.tile_index));
+	add_level_tile(0);
+	add_level_tile(1);
+	for (int i = 0; i != level.cell_count; i++) add_level_tile(level.initial_map[i]);
+
+	/* Plus anything that can come out of merging them */
+	for (int i = 0; i != level.tile_count; i++) {
+		for (int j = 0; j != level.tile_count; j++) {
+			unsigned char result = get_tile_combination(level.tile_values[i], level.tile_values[j]);
+			if (result) add_level_tile(result);
+			result = get_tile_combination(level.tile_values[j], level.tile_values[i]);
+			if (result) add_level_tile(result);
+		}
+	}
+	for (level.tile_bits = 1; (1 << level.tile_bits) < level.tile_count; level.tile_bits++);
+	level.tile_mask = (1 << level.tile_bits) - 1;
+
+	level.dynamic_count = 0;
+	for (int i = 0; i != level.cell_count; i++) {
+		if (is_static_tile(level.initial_map[i])) {
+			level.dynamic_index[i] = -1;
+		} else {
+			level.dynamic_index[i] = level.dynamic_count;
+			level.dynamic_cells[level.dynamic_count] = i;
+			level.dynamic_count++;
+		}
+	}
+
+	/* 2 bytes for the player's cell, then 2 layers per dynamic cell, plus a spare byte, since tiles are read 2 bytes at a time */
+	level.state_size = 2 + (level.dynamic_count * 2 * level.tile_bits + 7) / 8 + 1;
+	level.entry_size = sizeof(uint64_t) + sizeof(uint32_t) + level.state_size;
+
+	uint64_t seed = 0x5EED;
+	free(level.zobrist_player);
+	free(level.zobrist_cells);
+	level.zobrist_player = malloc(level.cell_count * sizeof(uint64_t));
+	level.zobrist_cells = malloc((size_t) level.dynamic_count * 2 * level.tile_count * sizeof(uint64_t));
+	for (int i = 0; i != level.cell_count; i++) level.zobrist_player[i] = splitmix64(&seed);
+	for (long i = 0; i != (long) level.dynamic_count * 2 * level.tile_count; i++) level.zobrist_cells[i] = splitmix64(&seed);
+}
+
+uint64_t zobrist_cell(int cell, int layer, unsigned char tile) {
+	int index = level.dynamic_index[cell];
+	return level.zobrist_cells[((size_t) index * 2 + layer) * level.tile_count + level.tile_index[tile]];
+}
+
+/* The static cells aren't on the packed state: they keep their initial tiles, over an empty floor */
+unsigned char get_board_tile(solver_board *board, int cell, int layer) {
+	int index = level.dynamic_index[cell];
+	if (index < 0) return layer ? 0 : level.initial_map[cell];
+
+	unsigned int bit = (index * 2 + layer) * level.tile_bits;
+	unsigned char *p = board->state + 2 + (bit >> 3);
+	unsigned int bits = p[0] | p[1] << 8;
+	return level.tile_values[(bits >> (bit & 7)) & level.tile_mask];
+}
+
+void put_board_tile(solver_board *board, int cell, int layer, unsigned char tile) {
+	unsigned int bit = (level.dynamic_index[cell] * 2 + layer) * level.tile_bits;
+	unsigned char *p = board->state + 2 + (bit >> 3);
+	unsigned int bits = p[0] | p[1] << 8;
+	bits = (bits & ~(level.tile_mask << (bit & 7))) | level.tile_index[tile] << (bit & 7);
+	p[0] = bits;
+	p[1] = bits >> 8;
+}
+
+void set_board_tile(solver_board *board, int cell, int layer, unsigned char tile) {
+	board->hash ^= zobrist_cell(cell, layer, get_board_tile(board, cell, layer)) ^ zobrist_cell(cell, layer, tile);
+	put_board_tile(board, cell, layer, tile);
+}
+
+void set_board_player(solver_board *board, int cell) {
+	board->hash ^= level.zobrist_player[board->player_cell] ^ level.zobrist_player[cell];
+	board->player_cell = cell;
+	board->state[0] = cell;
+	board->state[1] = cell >> 8;
+}
+
+/* Builds the initial state of the level on the given buffer */
+void init_board(solver_board *board, unsigned char *state) {
+	memset(state, 0, level.state_size);
+	board->state = state;
+	board->player_cell = level.start_cell;
+	board->state[0] = level.start_cell;
+	board->state[1] = level.start_cell >> 8;
+	board->hash = level.zobrist_player[level.start_cell];
+
+	for (int i = 0; i != level.dynamic_count; i++) {
+		int cell = level.dynamic_cells[i];
+		put_board_tile(board, cell, 0, level.initial_map[cell]);
+		put_board_tile(board, cell, 1, 0);
+		board->hash ^= zobrist_cell(cell, 0, level.initial_map[cell]) ^ zobrist_cell(cell, 1, 0);
+	}
+}
+
+/* Same rules as try_pushing_tile_on_map() */
+int push_board_tile(solver_board *board, int x, int y, int delta_x, int delta_y) {
+	unsigned char new_x = x + delta_x;
+	unsigned char new_y = y + delta_y;
+	if (new_x >= level.width || new_y >= level.height) return 0;
+
+	int cell = y * level.width + x;
+	int new_cell = new_y * level.width + new_x;
+	unsigned char target_tile = get_board_tile(board, new_cell, 0);
+	unsigned char source_tile = get_board_tile(board, cell, 0);
+	unsigned char source_floor_tile = get_board_tile(board, cell, 1);
+
+	unsigned char tile_combination = get_tile_combination(source_tile, target_tile);
+	if (tile_combination) {
+		set_board_tile(board, cell, 0, source_floor_tile ? source_floor_tile : 1);
+		set_board_tile(board, cell, 1, 0);
+		set_board_tile(board, new_cell, 0, tile_combination);
+		return 1;
+	}
+
+	if (get_tile_attr(target_tile) & TILE_ATTR_SOLID) return 0;
+
+	set_board_tile(board, cell, 0, source_floor_tile ? source_floor_tile : 1);
+	set_board_tile(board, cell, 1, 0);
+	set_board_tile(board, new_cell, 0, source_tile);
+	set_board_tile(board, new_cell, 1, target_tile > 1 ? target_tile : 0);
+	return 1;
+}
+
+/* Same rules as try_moving_actor_on_map(): bumping into an exit clears the level, even if the move is blocked */
+int move_board_player(solver_board *board, int direction) {
+	int x = board->player_cell % level.width;
+	int y = board->player_cell / level.width;
+	int delta_x = direction_delta_x[direction];
+	int delta_y = direction_delta_y[direction];
+
+	unsigned char new_x = x + delta_x;
+	unsigned char new_y = y + delta_y;
+	if (new_x >= level.width || new_y >= level.height) return SOLVER_BLOCKED;
+
+	int new_cell = new_y * level.width + new_x;
+	unsigned char tile_attr = get_tile_attr(get_board_tile(board, new_cell, 0));
+	int result = tile_attr & TILE_ATTR_PLAYER_END ? SOLVER_CLEAR : SOLVER_MOVED;
+
+	if (tile_attr & TILE_ATTR_PUSHABLE) {
+		if (!push_board_tile(board, new_x, new_y, delta_x, delta_y)) return result == SOLVER_CLEAR ? SOLVER_CLEAR : SOLVER_BLOCKED;
+	} else if (tile_attr & TILE_ATTR_SOLID) {
+		return result == SOLVER_CLEAR ? SOLVER_CLEAR : SOLVER_BLOCKED;
+	}
+
+	set_board_player(board, new_cell);
+	return result;
+}
+
+/* Returns 1 if the state wasn't on the table yet */
+int table_insert(uint64_t hash) {
+	if (!hash) hash = 1;
+
+	uint64_t slot = hash & table_mask;
+	while (1) {
+		uint64_t current = __atomic_load_n(table + slot, __ATOMIC_RELAXED);
+		if (current == hash) return 0;
+		if (!current) {
+			uint64_t expected = 0;
+			if (__atomic_compare_exchange_n(table + slot, &expected, hash, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) return 1;
+			if (expected == hash) return 0;
+		}
+		slot = (slot + 1) & table_mask;
+	}
+}
+
+/* Returns SOLVER_NO_NODE when max_states is reached */
+uint32_t new_node(uint32_t parent, unsigned char move) {
+	uint32_t node = __atomic_fetch_add(&node_count, 1, __ATOMIC_RELAXED);
+	if (node >= max_states) {
+		__atomic_store_n(&out_of_states, 1, __ATOMIC_RELAXED);
+		return SOLVER_NO_NODE;
+	}
+
+	node_parent[node] = parent;
+	node_move[node] = move;
+	return node;
+}
+
+unsigned char *buffer_append(solver_buffer *buffer) {
+	if ((buffer->count + 1) * level.entry_size > buffer->capacity) {
+		buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 65536;
+		if (buffer->capacity < (buffer->count + 1) * level.entry_size) buffer->capacity = (buffer->count + 1) * level.entry_size;
+		buffer->data = realloc(buffer->data, buffer->capacity);
+		if (!buffer->data) {
+			fprintf(stderr, "Out of memory\n");
+			exit(2);
+		}
+	}
+
+	return buffer->data + buffer->count++ * level.entry_size;
+}
+
+/* Each move is played on a copy of the state, at the end of the worker's next layer; it's only kept if it's new */
+void expand_entry(solver_worker *worker, const unsigned char *entry) {
+	const size_t header_size = sizeof(uint64_t) + sizeof(uint32_t);
+	solver_board board;
+	uint64_t hash;
+	uint32_t node;
+
+	memcpy(&hash, entry, sizeof(hash));
+	memcpy(&node, entry + sizeof(hash), sizeof(node));
+
+	for (int direction = 0; direction != 4; direction++) {
+		unsigned char *child_entry = buffer_append(&worker->next);
+		board.state = child_entry + header_size;
+		memcpy(board.state, entry + header_size, level.state_size);
+		board.player_cell = board.state[0] | board.state[1] << 8;
+		board.hash = hash;
+
+		int result = move_board_player(&board, direction);
+		if (result == SOLVER_CLEAR) {
+			uint32_t expected = SOLVER_NO_NODE;
+			if (__atomic_compare_exchange_n(&solution_node, &expected, node, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				solution_move = direction;
+			}
+		}
+
+		uint32_t child = SOLVER_NO_NODE;
+		if (result == SOLVER_MOVED && table_insert(board.hash)) child = new_node(node, direction);
+		if (child == SOLVER_NO_NODE) {
+			worker->next.count--;
+			if (result == SOLVER_CLEAR || out_of_states) return;
+			continue;
+		}
+
+		memcpy(child_entry, &board.hash, sizeof(board.hash));
+		memcpy(child_entry + sizeof(board.hash), &child, sizeof(child));
+	}
+}
+
+/* Returns -1 when the deque is empty */
+int deque_pop_back(solver_deque *deque) {
+	int chunk = -1;
+	pthread_mutex_lock(&deque->lock);
+	if (deque->front != deque->back) chunk = deque->chunks[--deque->back];
+	pthread_mutex_unlock(&deque->lock);
+	return chunk;
+}
+
+int deque_steal_front(solver_deque *deque) {
+	int chunk = -1;
+	pthread_mutex_lock(&deque->lock);
+	if (deque->front != deque->back) chunk = deque->chunks[deque->front++];
+	pthread_mutex_unlock(&deque->lock);
+	return chunk;
+}
+
+int is_search_over() {
+	return __atomic_load_n(&solution_node, __ATOMIC_RELAXED) != SOLVER_NO_NODE || __atomic_load_n(&out_of_states, __ATOMIC_RELAXED);
+}
+
+/* Expands one BFS layer; no chunks are added while it runs, so once every deque is empty, the layer is done */
+void *worker_main(void *arg) {
+	solver_worker *worker = arg;
+
+	while (!is_search_over()) {
+		int chunk = deque_pop_back(deques + worker->id);
+		for (int i = 1; chunk < 0 && i != thread_count; i++) {
+			chunk = deque_steal_front(deques + (worker->id + i) % thread_count);
+			if (chunk >= 0) worker->steals++;
+		}
+		if (chunk < 0) break;
+
+		size_t start = (size_t) chunk * SOLVER_CHUNK_SIZE;
+		size_t end = start + SOLVER_CHUNK_SIZE < frontier.count ? start + SOLVER_CHUNK_SIZE : frontier.count;
+		for (size_t i = start; i != end && !is_search_over(); i++) {
+			expand_entry(worker, frontier.data + i * level.entry_size);
+		}
+	}
+
+	return 0;
+}
+
+void expand_layer() {
+	int chunk_count = (frontier.count + SOLVER_CHUNK_SIZE - 1) / SOLVER_CHUNK_SIZE;
+
+	for (int t = 0; t != thread_count; t++) {
+		solver_deque *deque = deques + t;
+		deque->chunks = realloc(deque->chunks, (chunk_count / thread_count + 1) * sizeof(int));
+		deque->front = deque->back = 0;
+		workers[t].next.count = 0;
+	}
+	for (int c = 0; c != chunk_count; c++) {
+		solver_deque *deque = deques + c % thread_count;
+		deque->chunks[deque->back++] = c;
+	}
+
+	pthread_t threads[SOLVER_MAX_THREADS];
+	for (int t = 1; t < thread_count; t++) pthread_create(threads + t, 0, worker_main, workers + t);
+	worker_main(workers);
+	for (int t = 1; t < thread_count; t++) pthread_join(threads[t], 0);
+
+	/* The next layer is everything the workers found */
+	frontier.count = 0;
+	for (int t = 0; t != thread_count; t++) {
+		solver_buffer *next = &workers[t].next;
+		for (size_t i = 0; i != next->count; i++) {
+			memcpy(buffer_append(&frontier), next->data + i * level.entry_size, level.entry_size);
+		}
+	}
+}
+
+/*
+ * Sets max_states for the current level, so that the search fits in memory_budget, and grows the transposition
+ * table and the node arrays to match. Each state takes its frontier entry twice, since a layer is copied from
+ * the workers' buffers to the frontier, up to 4 table slots, since the table is at most half full and rounded
+ * up to a power of two, and its parent and move.
+ */
+void reserve_states() {
+	size_t state_bytes = 2 * (size_t) level.entry_size + 4 * sizeof(uint64_t) + sizeof(uint32_t) + 1;
+	size_t state_count = memory_budget / state_bytes;
+	max_states = state_count < max_state_limit ? state_count : max_state_limit;
+	if (!max_states) max_states = 1;
+
+	/* At most half full, so that probing stays short */
+	for (table_mask = 1; table_mask < (uint64_t) max_states * 2; table_mask <<= 1);
+	if (table_mask > table_capacity) {
+		free(table);
+		table = malloc(table_mask * sizeof(uint64_t));
+		table_capacity = table_mask;
+	}
+	table_mask--;
+
+	if (max_states > node_capacity) {
+		free(node_parent);
+		free(node_move);
+		node_parent = malloc((size_t) max_states * sizeof(uint32_t));
+		node_move = malloc(max_states);
+		node_capacity = max_states;
+	}
+
+	if (!table || !node_parent || !node_move) {
+		fprintf(stderr, "Out of memory\n");
+		exit(2);
+	}
+}
+
+/* Returns the length of the shortest solution, 0 if there's none, or -1 if max_states was reached first */
+int solve_level(char *solution, int solution_size) {
+	memset(table, 0, (table_mask + 1) * sizeof(uint64_t));
+	node_count = 0;
+	out_of_states = 0;
+	solution_node = SOLVER_NO_NODE;
+	frontier.count = 0;
+
+	unsigned char *entry = buffer_append(&frontier);
+	solver_board board;
+	init_board(&board, entry + sizeof(uint64_t) + sizeof(uint32_t));
+	table_insert(board.hash);
+	uint32_t root = new_node(SOLVER_NO_NODE, 0);
+	memcpy(entry, &board.hash, sizeof(board.hash));
+	memcpy(entry + sizeof(board.hash), &root, sizeof(root));
+
+	while (frontier.count && !is_search_over()) expand_layer();
+
+	if (solution_node == SOLVER_NO_NODE) return out_of_states ? -1 : 0;
+
+	/* Walks back to the root */
+	int length = 1;
+	for (uint32_t node = solution_node; node_parent[node] != SOLVER_NO_NODE; node = node_parent[node]) length++;
+
+	if (length < solution_size) {
+		solution[length] = 0;
+		solution[length - 1] = solver_move_names[solution_move];
+		int i = length - 2;
+		for (uint32_t node = solution_node; node_parent[node] != SOLVER_NO_NODE; node = node_parent[node]) {
+			solution[i--] = solver_move_names[node_move[node]];
+		}
+	} else {
+		solution[0] = 0;
+	}
+
+	return length;
+}
+
+/* Plays the solution with the ROM's own move functions; the level must be cleared on the last move, not before */
+int replay_solution(int level_number, const char *solution) {
+	resource_map_format *map = start_level(level_number);
+
+	for (const char *move = solution; *move; move++) {
+		if (stage_clear) return 0;
+		apply_move(map, *move);
+	}
+
+	return stage_clear;
+}
+
+void usage(const char *program_name) {
+	fprintf(stderr, "Usage: %s [-t threads] [-M megabytes] [-m max states] [-s] <file.resource.bin> [first level] [last level]\n", program_name);
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	long max_state_count = SOLVER_NO_NODE - 1;
+	long memory_mb = SOLVER_DEFAULT_MEMORY_MB;
+	int print_solutions = 0;
+	int option;
+
+	thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+	while ((option = getopt(argc, argv, "t:M:m:s")) != -1) {
+		switch (option) {
+		case 't': thread_count = atoi(optarg); break;
+		case 'M': memory_mb = atol(optarg); break;
+		case 'm': max_state_count = atol(optarg); break;
+		case 's': print_solutions = 1; break;
+		default: usage(argv[0]);
+		}
+	}
+	if (optind >= argc || max_state_count < 1 || max_state_count >= SOLVER_NO_NODE || memory_mb < 1) usage(argv[0]);
+	if (thread_count < 1) thread_count = 1;
+	if (thread_count > SOLVER_MAX_THREADS) thread_count = SOLVER_MAX_THREADS;
+
+	load_resource_file(argv[optind]);
+	vram_queue_init();
+
+	int first_level = optind + 1 < argc ? atoi(argv[optind + 1]) : 1;
+	int last_level = optind + 2 < argc ? atoi(argv[optind + 2]) : resource_header->level_count;
+
+	memory_budget = (size_t) memory_mb << 20;
+	max_state_limit = max_state_count;
+	for (int t = 0; t != thread_count; t++) {
+		workers[t].id = t;
+		pthread_mutex_init(&deques[t].lock, 0);
+	}
+
+	static char solution[MAP_MAX_W * MAP_MAX_H * 16];
+	int unproven = 0;
+	double total_start = now_seconds();
+	unsigned long total_states = 0;
+
+	for (int level_number = first_level; level_number <= last_level; level_number++) {
+		resource_map_format *map = start_level(level_number);
+		if (!map) {
+			fprintf(stderr, "Level %d not found\n", level_number);
+			unproven++;
+			continue;
+		}
+		prepare_level(map);
+		reserve_states();
+
+		double start = now_seconds();
+		int length = solve_level(solution, sizeof(solution));
+		double elapsed = now_seconds() - start;
+		unsigned long states = node_count < max_states ? node_count : max_states;
+		total_states += states;
+
+		fprintf(stdout, "level %4d  %-24.24s %2dx%-2d  ", level_number, map->name, level.width, level.height);
+		if (length > 0) {
+			fprintf(stdout, "solved     %5d moves", length);
+		} else {
+			fprintf(stdout, "%-22s", length ? "unknown (state limit)" : "unsolvable");
+			unproven++;
+		}
+		fprintf(stdout, "  %9lu states  %7.2f s  %10.0f states/s\n", states, elapsed, states / (elapsed > 0 ? elapsed : 1e-9));
+
+		if (length > 0 && solution[0]) {
+			if (!replay_solution(level_number, solution)) {
+				fprintf(stdout, "FAIL: level %d: the ROM doesn't clear the level with %s\n", level_number, solution);
+				unproven++;
+			} else if (print_solutions) {
+				fprintf(stdout, "%d %s\n", level_number, solution);
+			}
+		}
+	}
+
+	double total_elapsed = now_seconds() - total_start;
+	unsigned long steals = 0;
+	for (int t = 0; t != thread_count; t++) steals += workers[t].steals;
+	fprintf(stdout, "%d thread(s), %lu states in %.2f s (%.0f states/s), %lu chunk(s) stolen\n",
+		thread_count, total_states, total_elapsed, total_states / (total_elapsed > 0 ? total_elapsed : 1e-9), steals);
+
+	return unproven ? 1 : 0;
+}
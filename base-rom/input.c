@@ -0,0 +1,67 @@
+#include "lib/SMSlib.h"
+#include "input.h"
+
+#define INPUT_QUEUE_MASK (INPUT_QUEUE_SIZE - 1)
+
+/* When several keys are pressed on the same frame, their actions are queued in this order */
+const unsigned int input_keys[INPUT_ACTION_COUNT] = {
+	PORT_A_KEY_UP, PORT_A_KEY_DOWN, PORT_A_KEY_LEFT, PORT_A_KEY_RIGHT, PORT_A_KEY_1, PORT_A_KEY_2
+};
+
+#define INPUT_ACTION_KEYS (PORT_A_KEY_UP | PORT_A_KEY_DOWN | PORT_A_KEY_LEFT | PORT_A_KEY_RIGHT | PORT_A_KEY_1 | PORT_A_KEY_2)
+
+unsigned char input_queue[INPUT_QUEUE_SIZE];
+
+/* Free running positions; only masked when accessing the queue */
+unsigned char input_queue_start, input_queue_end;
+
+/* Action of the last key pressed, for as long as it's held */
+unsigned char input_repeat_action;
+unsigned char input_repeat_timer;
+
+void input_clear() {
+	input_queue_start = 0;
+	input_queue_end = 0;
+	input_repeat_action = INPUT_NONE;
+}
+
+void input_push(unsigned char action) {
+	/* Only happens if the game stops taking actions; the newest ones are dropped */
+	if ((unsigned char) (input_queue_end - input_queue_start) == INPUT_QUEUE_SIZE) return;
+	
+	input_queue[input_queue_end & INPUT_QUEUE_MASK] = action;
+	input_queue_end++;
+}
+
+void input_update() {
+	static unsigned int pressed;
+	static unsigned char i;
+	
+	pressed = SMS_getKeysPressed() & INPUT_ACTION_KEYS;
+	if (pressed) {
+		for (i = 0; i != INPUT_ACTION_COUNT; i++) {
+			if (pressed & input_keys[i]) {
+				input_push(i);
+				input_repeat_action = i;
+			}
+		}
+		input_repeat_timer = INPUT_DAS;
+	} else if (input_repeat_action != INPUT_NONE) {
+		if (!(SMS_getKeysHeld() & input_keys[input_repeat_action])) {
+			input_repeat_action = INPUT_NONE;
+		} else if (!--input_repeat_timer) {
+			input_repeat_timer = INPUT_ARR;
+			if (input_queue_start == input_queue_end) input_push(input_repeat_action);
+		}
+	}
+}
+
+unsigned char input_next_action() {
+	static unsigned char action;
+	
+	if (input_queue_start == input_queue_end) return INPUT_NONE;
+	
+	action = input_queue[input_queue_start & INPUT_QUEUE_MASK];
+	input_queue_start++;
+	return action;
+}
@@ -0,0 +1,44 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+/*
+ * Buffered input: presses are detected on the frame they happen, through SMS_getKeysPressed(), and
+ * queued as actions, so quick taps are never lost, even if several come in before the game can act
+ * on them; the game takes at most one action per frame with input_next_action().
+ *
+ * Holding a key repeats its action after INPUT_DAS frames, then every INPUT_ARR frames; repeats are
+ * only queued when the queue is empty, so they never pile up behind the taps.
+ */
+
+/* Must be a power of two */
+#ifndef INPUT_QUEUE_SIZE
+#define INPUT_QUEUE_SIZE (8)
+#endif
+
+/* Delayed auto shift and auto repeat rate, in frames; both must be at least 1 */
+#ifndef INPUT_DAS
+#define INPUT_DAS (12)
+#endif
+#ifndef INPUT_ARR
+#define INPUT_ARR (4)
+#endif
+
+/* Same order as the UNDO_DIR_* directions */
+#define INPUT_UP (0)
+#define INPUT_DOWN (1)
+#define INPUT_LEFT (2)
+#define INPUT_RIGHT (3)
+#define INPUT_UNDO (4)
+#define INPUT_REDO (5)
+#define INPUT_ACTION_COUNT (6)
+#define INPUT_NONE (0xFF)
+
+void input_clear();
+
+/* Must be called once per frame, after SMS_waitForVBlank() */
+void input_update();
+
+/* Returns INPUT_NONE if there's nothing to do */
+unsigned char input_next_action();
+
+#endif /* INPUT_H */
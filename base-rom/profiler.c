@@ -0,0 +1,108 @@
+#ifdef PROFILER
+
+#include <stdio.h>
+#include "lib/SMSlib.h"
+#include "profiler.h"
+
+#define LINES_PER_FRAME (262)
+#define CYCLES_PER_LINE (228)
+
+/* On NTSC, the V counter goes from 0x00 to 0xDA, then jumps back to 0xD5 for the last lines of the frame */
+#define VCOUNT_JUMP_FROM (0xDA)
+#define VCOUNT_JUMP_SIZE (0xDA - 0xD5 + 1)
+
+/* The raster bars are drawn by changing the color of this sprite palette entry: the backdrop shows it, and sprites never do */
+#define PROFILER_BACKDROP_ENTRY (0)
+
+profiler_section profiler_sections[PROFILE_SECTION_COUNT];
+unsigned char profiler_frame_count;
+char profiler_text_shown = 1;
+
+const char *profiler_section_names[PROFILE_SECTION_COUNT] = { "INP", "ACT", "MAP", "VBL", "AUD" };
+
+/* Where each section's statistics are shown; the map starts on line 6, and the HUD leaves the left of line 3 free */
+const unsigned char profiler_section_x[PROFILE_SECTION_COUNT] = { 0, 16, 0, 16, 0 };
+const unsigned char profiler_section_y[PROFILE_SECTION_COUNT] = { 4, 4, 5, 5, 3 };
+
+/* Colors for the raster bars, as written to CRAM (%00BBGGRR); between sections, the backdrop is black */
+const unsigned char profiler_section_colors[PROFILE_SECTION_COUNT] = { 0x03, 0x0C, 0x30, 0x3F, 0x0F };
+
+void profiler_show_text(char show) {
+	profiler_text_shown = show;
+}
+
+void profiler_reset_section(profiler_section *sec) {
+	sec->min_lines = 0xFF;
+	sec->max_lines = 0;
+	sec->total_lines = 0;
+}
+
+/*
+ * Scanlines from start_vcount to end_vcount, as read from the V counter, with the jump taken into account.
+ * Readings from 0xD5 to 0xDA come up twice per frame, and are taken to be the ones before the jump,
+ * so a section that starts or ends on one of the last 6 lines of the frame may be off by up to 6 lines.
+ */
+unsigned int profiler_elapsed_lines(unsigned char start_vcount, unsigned char end_vcount) {
+	/* Not static: the audio tick calls this from the line interrupt */
+	unsigned int start_line = start_vcount > VCOUNT_JUMP_FROM ? start_vcount + VCOUNT_JUMP_SIZE : start_vcount;
+	unsigned int end_line = end_vcount > VCOUNT_JUMP_FROM ? end_vcount + VCOUNT_JUMP_SIZE : end_vcount;
+	if (end_line < start_line) end_line += LINES_PER_FRAME;
+	
+	return end_line - start_line;
+}
+
+void profiler_begin(unsigned char section) {
+	profiler_sections[section].start_line = SMS_getVCount();
+	SMS_setBackdropColor(PROFILER_BACKDROP_ENTRY);
+	SMS_setSpritePaletteColor(PROFILER_BACKDROP_ENTRY, profiler_section_colors[section]);
+}
+
+void profiler_add(unsigned char section, unsigned char lines) {
+	static profiler_section *sec;
+	
+	sec = profiler_sections + section;
+	if (lines < sec->min_lines) sec->min_lines = lines;
+	if (lines > sec->max_lines) sec->max_lines = lines;
+	sec->total_lines += lines;
+}
+
+void profiler_end(unsigned char section) {
+	static unsigned int lines;
+	
+	lines = profiler_elapsed_lines(profiler_sections[section].start_line, SMS_getVCount());
+	if (lines > 0xFF) lines = 0xFF;
+	
+	profiler_add(section, lines);
+	
+	SMS_setSpritePaletteColor(PROFILER_BACKDROP_ENTRY, 0);
+}
+
+/*
+ * To be called once per frame, during VBlank; shows min/avg/max scanlines per section every PROFILE_FRAMES frames,
+ * unless profiler_show_text(0) was called; the statistics are still computed then, for a debugger to look at.
+ */
+void profiler_frame() {
+	static profiler_section *sec;
+	static unsigned char i;
+	
+	profiler_frame_count++;
+	if (profiler_frame_count < PROFILE_FRAMES) return;
+	profiler_frame_count = 0;
+	
+	for (i = 0, sec = profiler_sections; i != PROFILE_SECTION_COUNT; i++, sec++) {
+		if (sec->min_lines > sec->max_lines) sec->min_lines = sec->max_lines;
+		
+		sec->min_cycles = sec->min_lines * CYCLES_PER_LINE;
+		sec->avg_cycles = (sec->total_lines / PROFILE_FRAMES) * CYCLES_PER_LINE;
+		sec->max_cycles = sec->max_lines * CYCLES_PER_LINE;
+		
+		if (profiler_text_shown) {
+			SMS_setNextTileatXY(profiler_section_x[i], profiler_section_y[i]);
+			printf("%s%3u/%3u/%3u ", profiler_section_names[i], sec->min_lines, sec->total_lines / PROFILE_FRAMES, sec->max_lines);
+		}
+		
+		profiler_reset_section(sec);
+	}
+}
+
+#endif /* PROFILER */
@@ -0,0 +1,54 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/* Compile with -DPROFILER to enable; otherwise, the markers compile to nothing. */
+
+#define PROFILE_INPUT (0)
+#define PROFILE_ACTORS (1)
+#define PROFILE_MAP (2)
+#define PROFILE_VBLANK (3)
+#define PROFILE_AUDIO (4)
+#define PROFILE_SECTION_COUNT (5)
+
+/* Number of frames the statistics are accumulated for, before being displayed */
+#define PROFILE_FRAMES (64)
+
+#ifdef PROFILER
+
+typedef struct profiler_section {
+	unsigned char start_line;
+	unsigned char min_lines, max_lines;
+	unsigned int total_lines;
+	
+	/* Results for the last PROFILE_FRAMES frames; each scanline takes 228 CPU cycles */
+	unsigned int min_cycles, avg_cycles, max_cycles;
+} profiler_section;
+
+extern profiler_section profiler_sections[PROFILE_SECTION_COUNT];
+
+void profiler_begin(unsigned char section);
+void profiler_end(unsigned char section);
+void profiler_add(unsigned char section, unsigned char lines);
+void profiler_frame();
+void profiler_show_text(char show);
+unsigned int profiler_elapsed_lines(unsigned char start_vcount, unsigned char end_vcount);
+
+#define PROFILE_BEGIN(section) profiler_begin(section)
+#define PROFILE_END(section) profiler_end(section)
+/* For sections measured elsewhere, such as inside an interrupt handler, where the profiler can't be called */
+#define PROFILE_ADD(section, lines) profiler_add(section, lines)
+#define PROFILE_FRAME() profiler_frame()
+/* The statistics are printed over the HUD; levels that take the whole screen only get the raster bars */
+#define PROFILE_SHOW_TEXT(show) profiler_show_text(show)
+
+#else
+
+#define PROFILE_BEGIN(section)
+#define PROFILE_END(section)
+#define PROFILE_ADD(section, lines)
+#define PROFILE_FRAME()
+#define PROFILE_SHOW_TEXT(show)
+
+#endif /* PROFILER */
+
+#endif /* PROFILER_H */
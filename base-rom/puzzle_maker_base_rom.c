@@ -5,6 +5,11 @@
 #include "lib/PSGlib.h"
 #include "data.h"
 #include "actor.h"
+#include "vram_queue.h"
+#include "profiler.h"
+#include "undo.h"
+#include "input.h"
+#include "audio.h"
 
 #define SCREEN_W (256)
 #define SCREEN_H (192)
@@ -15,27 +20,69 @@
 #define STATE_GAMEOVER (3)
 
 #define RESOURCE_BANK (2)
+#ifndef RESOURCE_BASE_ADDR
 #define RESOURCE_BASE_ADDR (0x8000)
+#endif
+#define RESOURCE_PAGE_SIZE (0x4000)
+
+// Stored on the last byte of the resource signature; same as RESOURCE_FORMAT_VERSION on game-resource.js.
+// No parentheses, since it also goes into resource_format_tag.
+#define RESOURCE_FORMAT_VERSION 1
+#define STRINGIFY(x) #x
+#define STRINGIFY_VALUE(x) STRINGIFY(x)
 
 #define MAP_SCREEN_Y (6)
+#define MAP_MAX_W (64)
+#define MAP_MAX_H (64)
+// map_data is the biggest thing on RAM; a full 64x64 map would take half of it.
+#define MAP_MAX_CELLS (2048)
+#define MAX_DIRTY_CELLS (8)
+
+// Each map cell takes 2x2 name table entries; the name table holds 16x14 cells, of which 16x12 are visible.
+#define VIEW_CELL_W (SCREEN_CHAR_W >> 1)
+#define VIEW_CELL_H (SCREEN_CHAR_H >> 1)
+#define NAME_TABLE_CELL_H (SCROLL_CHAR_H >> 1)
+
+// Maps up to this size are shown below the HUD, without scrolling.
+#define FIXED_MAP_MAX_W (VIEW_CELL_W)
+#define FIXED_MAP_MAX_H (VIEW_CELL_H - (MAP_SCREEN_Y >> 1))
+
+// How close to the edges of the screen the player can get before it scrolls, in cells
+#define CAMERA_MARGIN (4)
+
+// Must be a power of two; one slot is always kept empty, so levels can have up to MAX_FLOOR_CELLS - 1 pushable tiles.
+#define MAX_FLOOR_CELLS (128)
+#define MIN_FLOOR_CELLS (8)
 
 #define TILE_ATTR_SOLID (0x0001)
 #define TILE_ATTR_PLAYER_START (0x0002)
 #define TILE_ATTR_PLAYER_END (0x0004)
 #define TILE_ATTR_PUSHABLE (0x0008)
 
+#define MAX_TILE_TYPES (256)
+#define MAX_TILE_COMBINATIONS (255)
+
+// The tileset goes from VRAM tile 4 (metatile 0 is blank) up to the font, at tile 352.
+#define FIRST_TILESET_TILE (4)
+#define MAX_TILESET_TILES (352 - FIRST_TILESET_TILE)
+
 actor player;
 
 typedef struct resource_header_format {
 	char signature[4];
 	unsigned int file_count;
+	unsigned int level_count;
 } resource_header_format;
 
-typedef struct resource_entry_format {
-	char name[14];
+typedef struct resource_location_format {
 	unsigned int page;
 	unsigned int size;
 	unsigned int offset;
+} resource_location_format;
+
+typedef struct resource_entry_format {
+	char name[14];
+	resource_location_format location;
 } resource_entry_format;
 
 typedef struct resource_map_format {
@@ -43,48 +90,174 @@ typedef struct resource_map_format {
 	unsigned int width;
 	unsigned int height;
 	char name[32];
-	char tiles[];
+	unsigned char tiles[];
 } resource_map_format;
 
-const resource_header_format *resource_header = RESOURCE_BASE_ADDR;
-const resource_entry_format *resource_entries = RESOURCE_BASE_ADDR + sizeof(resource_header_format);
+// A song or sound effect, ready to be handed to PSGlib; page is 0 if the resource has none.
+typedef struct audio_resource {
+	unsigned char page;
+	void *data;
+} audio_resource;
+
+typedef struct map_cell {
+	char x, y;
+} map_cell;
 
-resource_entry_format *tile_attrs;
-resource_entry_format *tile_combinations;
+// Only valid while RESOURCE_BANK is mapped
+#define resource_header ((resource_header_format *) RESOURCE_BASE_ADDR)
+#define resource_entries ((resource_entry_format *) (RESOURCE_BASE_ADDR + sizeof(resource_header_format)))
+
+// Tile attributes and combinations are copied to RAM, so that no bank switching is needed during gameplay.
+unsigned char tile_attr_table[MAX_TILE_TYPES];
+unsigned char tile_combination_start[MAX_TILE_TYPES + 1];
+unsigned char tile_combination_dest[MAX_TILE_COMBINATIONS];
+unsigned char tile_combination_result[MAX_TILE_COMBINATIONS];
 char stage_clear;
 
-char map_data[9*16], map_floor[9*16];
+#ifdef BENCHMARK_ROM_LOOKUPS
+// The lookups go back to reading main.atr and merging.dat on ROM, so that the benchmarks can compare both ways.
+resource_location_format *tile_attr_location, *tile_combination_location;
+#endif
+
+char map_data[MAP_MAX_CELLS];
+
+// The floor layer is mostly empty, so it's kept as a hash table indexed by cell number.
+// A key of 0 marks an empty slot; otherwise, it's the cell number plus one.
+// Only the tiles under pushable tiles are kept, and only if they aren't the default (0, or tile 1), so there are
+// never more entries than pushable tiles on the level; the table only uses as many slots as the level needs.
+unsigned int floor_cell_key[MAX_FLOOR_CELLS];
+unsigned char floor_cell_tile[MAX_FLOOR_CELLS];
+unsigned char floor_cell_count;
+unsigned char floor_cell_mask = MAX_FLOOR_CELLS - 1;
+
+// Top left corner of the screen, in cells; in fixed mode, it's negative, so that the HUD is above the map.
+signed char camera_cell_x, camera_cell_y;
+// The name table row (in cells) that holds map row 0 when the vertical scroll is 0
+unsigned char map_row_origin;
+char is_map_scrolling;
+// The VRAM queue's mark for the last cells drawn by move_camera(); see update_scroll()
+unsigned char scroll_mark;
+
+// Name table entries for the 4 tiles of each metatile, in the same order as the tileset: top left, bottom left,
+// top right, bottom right. The table stays on ROM, after a count of metatiles; a page of 0 means there's no table,
+// and each metatile has 4 tiles of its own.
+unsigned char metatile_table_page;
+unsigned int metatile_table_offset;
+unsigned int metatile_entries[4];
+
+// A row or a column of cells that's being sent to the name table; the marks tell when the queue is done with them
+unsigned int stream_row[2][SCREEN_CHAR_W];
+unsigned int stream_column[2][SCREEN_CHAR_H];
+unsigned char stream_row_mark, stream_column_mark;
+
 char is_map_data_dirty;
 
-resource_entry_format *resource_find(char *name) {
+map_cell dirty_cells[MAX_DIRTY_CELLS];
+char dirty_cell_count;
+
+// The editor looks for this on the base ROM, and won't append a resource to a ROM that can't read it.
+const char resource_format_tag[] = "SMS-Puzzle-Maker rsc v" STRINGIFY_VALUE(RESOURCE_FORMAT_VERSION);
+
+char is_resource_format_supported() {
+	SMS_mapROMBank(RESOURCE_BANK);
+	return !strncmp(resource_header->signature, "rsc", 3) && resource_header->signature[3] == RESOURCE_FORMAT_VERSION;
+}
+
+resource_location_format *resource_find(char *name) {
 	SMS_mapROMBank(RESOURCE_BANK);
 
-	// TODO: Implement binary search; the names are already sorted.
-	// Searches sequentially, for now.
-	unsigned int remaining_entries = resource_header->file_count;
-	resource_entry_format *entry = resource_entries;
-	while (remaining_entries) {
-		if (!strcmp(name, entry->name)) {
-			return entry;
+	// The entries are sorted by name, so a binary search can be used.
+	unsigned int low = 0;
+	unsigned int high = resource_header->file_count;
+	while (low < high) {
+		unsigned int middle = (low + high) >> 1;
+		resource_entry_format *entry = resource_entries + middle;
+		
+		int comparison = strcmp(name, entry->name);
+		if (!comparison) {
+			return &entry->location;
 		}
 		
-		entry++;
-		remaining_entries--;
+		if (comparison < 0) {
+			high = middle;
+		} else {
+			low = middle + 1;
+		}
 	}
 	
 	return 0;
 }
 
-char *resource_get_pointer(resource_entry_format *entry) {
+resource_location_format *resource_find_level(unsigned int n) {
 	SMS_mapROMBank(RESOURCE_BANK);
 	
-	if (!entry) return 0;
+	if (!n || n > resource_header->level_count) return 0;
 	
-	unsigned int page = entry->page;
-	char *p = RESOURCE_BASE_ADDR + entry->offset;
+	// The level table comes right after the named entries, and has no names.
+	resource_location_format *level_locations = (resource_location_format *) (resource_entries + resource_header->file_count);
+	return level_locations + (n - 1);
+}
+
+char *resource_get_pointer(resource_location_format *location) {
+	SMS_mapROMBank(RESOURCE_BANK);
+	
+	if (!location) return 0;
+	
+	unsigned int page = location->page;
+	unsigned int offset = location->offset;
 	
 	SMS_mapROMBank(page);
-	return p;
+	return (char *) RESOURCE_BASE_ADDR + offset;
+}
+
+// Copies part of a resource to RAM. Unlike resource_get_pointer(), this also works for resources 
+// bigger than a page; those continue at offset 0 of the following pages.
+void resource_read(resource_location_format *location, unsigned int offset, void *dst, unsigned int size) {
+	SMS_mapROMBank(RESOURCE_BANK);
+	
+	unsigned long position = (unsigned long) location->offset + offset;
+	unsigned int page = location->page + (unsigned int) (position >> 14);
+	unsigned int page_offset = position & (RESOURCE_PAGE_SIZE - 1);
+	
+	char *d = dst;
+	while (size) {
+		unsigned int chunk_size = RESOURCE_PAGE_SIZE - page_offset;
+		if (chunk_size > size) chunk_size = size;
+		
+		SMS_mapROMBank(page);
+		memcpy(d, (char *) RESOURCE_BASE_ADDR + page_offset, chunk_size);
+		
+		d += chunk_size;
+		size -= chunk_size;
+		page++;
+		page_offset = 0;
+	}
+}
+
+// Songs and sound effects are optional; without them, the game is just silent.
+void load_audio_resource(audio_resource *audio, char *name) {
+	resource_location_format *location = resource_find(name);
+	
+	// PSGlib can't follow a song across pages, so those are ignored.
+	if (!location || location->size > RESOURCE_PAGE_SIZE) {
+		audio->page = 0;
+		return;
+	}
+	
+	audio->page = location->page;
+	audio->data = resource_get_pointer(location);
+}
+
+void play_music(audio_resource *music) {
+	if (music->page) {
+		audio_play_music(music->page, music->data);
+	} else {
+		audio_stop_music();
+	}
+}
+
+void play_sfx(audio_resource *sfx) {
+	if (sfx->page) audio_play_sfx(sfx->page, sfx->data, AUDIO_SFX_CHANNELS2AND3);
 }
 
 void load_standard_palettes() {
@@ -92,20 +265,13 @@ void load_standard_palettes() {
 	SMS_setBGPaletteColor(1, 0x3F);
 }
 
-void draw_tile(char x, char y, unsigned int tileNumber) {
-	static unsigned int sms_tile;
-	
-	y += MAP_SCREEN_Y;
-	
-	sms_tile = tileNumber << 2;
-	
-	SMS_setNextTileatXY(x, y);	
-	SMS_setTile(sms_tile);
-	SMS_setTile(sms_tile + 2);
+// The name table wraps around, both horizontally and vertically, so that it can be scrolled.
+unsigned char get_name_table_x(signed char x) {
+	return (x << 1) & (SCREEN_CHAR_W - 1);
+}
 
-	SMS_setNextTileatXY(x, y + 1);
-	SMS_setTile(sms_tile + 1);
-	SMS_setTile(sms_tile + 3);
+unsigned char get_name_table_y(signed char y) {
+	return ((unsigned char) (y + map_row_origin) % NAME_TABLE_CELL_H) << 1;
 }
 
 inline char *get_map_tile_pointer(resource_map_format *map, char *data, char x, char y) {
@@ -116,68 +282,486 @@ char get_map_tile(resource_map_format *map, char x, char y) {
 	return *(get_map_tile_pointer(map, map_data, x, y));
 }
 
+unsigned char get_visible_map_tile(resource_map_format *map, signed char x, signed char y) {
+	// Anything outside of the map is drawn as blank.
+	if (x < 0 || y < 0 || x >= map->width || y >= map->height) return 0;
+	return get_map_tile(map, x, y);
+}
+
+// Fills metatile_entries for the given metatile; the page that was on slot 2 is mapped back afterwards,
+// since the map header is read from ROM while drawing.
+void load_metatile_entries(unsigned char tile) {
+	if (!metatile_table_page) {
+		unsigned int sms_tile = tile << 2;
+		metatile_entries[0] = sms_tile;
+		metatile_entries[1] = sms_tile + 1;
+		metatile_entries[2] = sms_tile + 2;
+		metatile_entries[3] = sms_tile + 3;
+		return;
+	}
+	
+	unsigned char saved_page = ROM_bank_to_be_mapped_on_slot2;
+	SMS_mapROMBank(metatile_table_page);
+	
+	unsigned int *table = (unsigned int *) (RESOURCE_BASE_ADDR + metatile_table_offset);
+	if (tile < table[0]) {
+		memcpy(metatile_entries, table + 1 + (tile << 2), sizeof(metatile_entries));
+	} else {
+		memset(metatile_entries, 0, sizeof(metatile_entries));
+	}
+	
+	SMS_mapROMBank(saved_page);
+}
+
+void draw_tile(char x, char y, unsigned char tile) {
+	// Cells outside of the screen will be drawn when they scroll in.
+	if ((unsigned char) (x - camera_cell_x) >= VIEW_CELL_W || (unsigned char) (y - camera_cell_y) >= VIEW_CELL_H) return;
+	
+	load_metatile_entries(tile);
+	unsigned char name_x = get_name_table_x(x);
+	unsigned char name_y = get_name_table_y(y);
+	
+	vram_queue_name_tile(name_x, name_y, metatile_entries[0]);
+	vram_queue_name_tile(name_x + 1, name_y, metatile_entries[2]);
+	vram_queue_name_tile(name_x, name_y + 1, metatile_entries[1]);
+	vram_queue_name_tile(name_x + 1, name_y + 1, metatile_entries[3]);
+}
+
+void mark_map_cell_dirty(char x, char y) {
+	// Too many changes at once: just redraw everything.
+	if (dirty_cell_count == MAX_DIRTY_CELLS) {
+		is_map_data_dirty = 1;
+		return;
+	}
+	
+	map_cell *cell = dirty_cells + dirty_cell_count;
+	cell->x = x;
+	cell->y = y;
+	dirty_cell_count++;
+}
+
 void set_map_tile(resource_map_format *map, char x, char y, char new_value) {
-	*(get_map_tile_pointer(map, map_data, x, y)) = new_value;
+	char *p = get_map_tile_pointer(map, map_data, x, y);
+	if (*p == new_value) return;
+	
+	undo_record_cell(x, y, UNDO_LAYER_MAP, *p ^ new_value);
+	*p = new_value;
+	mark_map_cell_dirty(x, y);
+}
+
+// Sizes the table for the level on map_data, keeping it at most half full, then empties it.
+void clear_floor_tiles(unsigned int cell_count) {
+	unsigned int pushable_count = 0;
+	char *p = map_data;
+	for (unsigned int i = cell_count; i; i--, p++) {
+		if (tile_attr_table[(unsigned char) *p] & TILE_ATTR_PUSHABLE) pushable_count++;
+	}
+	
+	unsigned int size = MIN_FLOOR_CELLS;
+	while (size < MAX_FLOOR_CELLS && size < pushable_count * 2) size <<= 1;
+	floor_cell_mask = size - 1;
+	
+	memset(floor_cell_key, 0, size * sizeof(unsigned int));
+	floor_cell_count = 0;
+}
+
+// Returns the slot that holds the cell, or the empty slot where it would go.
+unsigned char find_floor_slot(unsigned int cell_number) {
+	unsigned int key = cell_number + 1;
+	unsigned char slot = cell_number & floor_cell_mask;
+	while (floor_cell_key[slot] && floor_cell_key[slot] != key) {
+		slot = (slot + 1) & floor_cell_mask;
+	}
+	return slot;
+}
+
+// Empties a slot; the entries that follow it are moved back when their probe sequence went through it.
+void remove_floor_slot(unsigned char slot) {
+	unsigned char next = slot;
+	for (;;) {
+		next = (next + 1) & floor_cell_mask;
+		unsigned int key = floor_cell_key[next];
+		if (!key) break;
+		
+		unsigned char home = (key - 1) & floor_cell_mask;
+		if (((next - home) & floor_cell_mask) >= ((next - slot) & floor_cell_mask)) {
+			floor_cell_key[slot] = key;
+			floor_cell_tile[slot] = floor_cell_tile[next];
+			slot = next;
+		}
+	}
+	
+	floor_cell_key[slot] = 0;
+	floor_cell_count--;
+}
+
+unsigned char read_floor_tile(unsigned int cell_number) {
+	unsigned char slot = find_floor_slot(cell_number);
+	return floor_cell_key[slot] ? floor_cell_tile[slot] : 0;
+}
+
+void write_floor_tile(unsigned int cell_number, unsigned char new_value) {
+	unsigned char slot = find_floor_slot(cell_number);
+	if (!floor_cell_key[slot]) {
+		// Absent cells read as 0; the generator refuses levels that could fill the table, but a full table drops new cells.
+		if (!new_value || floor_cell_count == floor_cell_mask) return;
+		
+		floor_cell_key[slot] = cell_number + 1;
+		floor_cell_count++;
+	} else if (!new_value) {
+		remove_floor_slot(slot);
+		return;
+	}
+	floor_cell_tile[slot] = new_value;
 }
 
 char get_floor_tile(resource_map_format *map, char x, char y) {
-	return *(get_map_tile_pointer(map, map_floor, x, y));
+	return read_floor_tile(y * map->width + x);
 }
 
 void set_floor_tile(resource_map_format *map, char x, char y, char new_value) {
-	*(get_map_tile_pointer(map, map_floor, x, y)) = new_value;
+	unsigned int cell_number = y * map->width + x;
+	
+	// Pushed tiles leave tile 1 behind by default, so there's no need to remember it.
+	if ((unsigned char) new_value <= 1) new_value = 0;
+	
+	undo_record_cell(x, y, UNDO_LAYER_FLOOR, read_floor_tile(cell_number) ^ new_value);
+	write_floor_tile(cell_number, new_value);
+}
+
+void load_tile_attrs() {
+	resource_location_format *location = resource_find("main.atr");
+	
+	unsigned int tile_count = location->size >> 1;
+	if (tile_count >= MAX_TILE_TYPES) tile_count = MAX_TILE_TYPES - 1;
+	
+	unsigned int *tile_attr_p = (unsigned int *) resource_get_pointer(location);
+	
+	memset(tile_attr_table, 0, sizeof(tile_attr_table));
+	for (unsigned int tile_number = 1; tile_number <= tile_count; tile_number++) {
+		tile_attr_table[tile_number] = *tile_attr_p;
+		tile_attr_p++;
+	}
+	
+	// Empty cells behave as tile 1.
+	tile_attr_table[0] = tile_attr_table[1];
+	
+#ifdef BENCHMARK_ROM_LOOKUPS
+	tile_attr_location = location;
+#endif
 }
 
-unsigned int get_tile_attr(char tile_number) {
+// merging.dat has a header with the tile and combination counts, the row starts, then the dest and result tiles.
+void load_tile_combinations() {
+	resource_location_format *location = resource_find("merging.dat");
+	
+	unsigned int header[2];
+	resource_read(location, 0, header, sizeof(header));
+	unsigned int tile_count = header[0];
+	unsigned int combination_count = header[1];
+	unsigned int row_starts_offset = sizeof(header);
+	unsigned int dest_tiles_offset = row_starts_offset + (tile_count + 1) * sizeof(unsigned int);
+	unsigned int result_tiles_offset = dest_tiles_offset + combination_count;
+	
+	// The generator refuses tilesets with more than that; this only keeps a bad resource from overflowing the tables.
+	if (combination_count > MAX_TILE_COMBINATIONS) combination_count = MAX_TILE_COMBINATIONS;
+	if (tile_count >= MAX_TILE_TYPES) tile_count = MAX_TILE_TYPES - 1;
+	
+	resource_read(location, dest_tiles_offset, tile_combination_dest, combination_count);
+	resource_read(location, result_tiles_offset, tile_combination_result, combination_count);
+	
+	// On the resource, the row for source tile N starts at index N - 1; the last entry marks the end.
+	tile_combination_start[0] = 0;
+	for (unsigned int source_tile = 1; source_tile <= MAX_TILE_TYPES; source_tile++) {
+		unsigned int row_start;
+		unsigned int row_index = source_tile <= tile_count ? source_tile - 1 : tile_count;
+		resource_read(location, row_starts_offset + row_index * sizeof(unsigned int), &row_start, sizeof(row_start));
+		tile_combination_start[source_tile] = row_start < combination_count ? row_start : combination_count;
+	}
+	
+#ifdef BENCHMARK_ROM_LOOKUPS
+	tile_combination_location = location;
+#endif
+}
+
+#ifdef BENCHMARK_ROM_LOOKUPS
+// Same results as below, read from ROM; the map's page is mapped back afterwards, as the caller may still be reading it.
+unsigned char get_tile_attr(unsigned char tile_number) {
+	unsigned char map_page = ROM_bank_to_be_mapped_on_slot2;
+	unsigned int *tile_attr_p = (unsigned int *) resource_get_pointer(tile_attr_location);
+	unsigned int tile_count = tile_attr_location->size >> 1;
+	
 	if (!tile_number) tile_number = 1;
-	unsigned int *tile_attr_p = resource_get_pointer(tile_attrs);
-	return tile_attr_p[tile_number - 1];	
+	unsigned char tile_attr = tile_number <= tile_count ? tile_attr_p[tile_number - 1] : 0;
+	
+	SMS_mapROMBank(map_page);
+	return tile_attr;
 }
 
-char get_tile_combination(char source_tile, char dest_tile) {
+unsigned char get_tile_combination(unsigned char source_tile, unsigned char dest_tile) {
+	unsigned char map_page = ROM_bank_to_be_mapped_on_slot2;
+	unsigned int *header = (unsigned int *) resource_get_pointer(tile_combination_location);
+	unsigned int tile_count = header[0];
+	unsigned char *dest_tiles = (unsigned char *) (header + 2 + tile_count + 1);
+	unsigned char *result_tiles = dest_tiles + header[1];
+	unsigned char result = 0;
+	
 	if (!source_tile) source_tile = 1;
 	if (!dest_tile) dest_tile = 1;
 	
-	char *tile_combos = resource_get_pointer(tile_combinations);
-	unsigned int tile_count = *((unsigned int *) tile_combos);
-	tile_combos += 2;
+	if (source_tile <= tile_count) {
+		unsigned int low = header[2 + source_tile - 1];
+		unsigned int high = header[2 + source_tile];
+		while (low < high) {
+			unsigned int middle = (low + high) >> 1;
+			unsigned char middle_tile = dest_tiles[middle];
+			
+			if (middle_tile == dest_tile) {
+				result = result_tiles[middle];
+				break;
+			}
+			
+			if (middle_tile < dest_tile) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+	}
 	
-	return tile_combos[tile_count * (source_tile - 1) + (dest_tile - 1)];
+	SMS_mapROMBank(map_page);
+	return result;
+}
+#else
+unsigned char get_tile_attr(unsigned char tile_number) {
+	return tile_attr_table[tile_number];
 }
 
-resource_map_format *load_map(int n) {
-	char map_file_name[14];
-	sprintf(map_file_name, "level%03d.map", n);
-	resource_map_format *map = (resource_map_format *) resource_get_pointer(resource_find(map_file_name));
-	return map;
+unsigned char get_tile_combination(unsigned char source_tile, unsigned char dest_tile) {
+	if (!source_tile) source_tile = 1;
+	if (!dest_tile) dest_tile = 1;
+	
+	// Each row is sorted by dest tile.
+	unsigned char low = tile_combination_start[source_tile];
+	unsigned char high = tile_combination_start[source_tile + 1];
+	while (low < high) {
+		unsigned char middle = (low + high) >> 1;
+		unsigned char middle_tile = tile_combination_dest[middle];
+		
+		if (middle_tile == dest_tile) return tile_combination_result[middle];
+		
+		if (middle_tile < dest_tile) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	
+	return 0;
 }
+#endif
 
-void prepare_map_data(resource_map_format *map) {
-	memcpy(map_data, map->tiles, map->height * map->width);
-	memcpy(map_floor, 0, map->height * map->width);
+resource_map_format *load_map(int n) {
+	resource_map_format *map = (resource_map_format *) resource_get_pointer(resource_find_level(n));
+	
+	// The generator refuses those; this only keeps a bad resource from overflowing map_data.
+	if (map && (map->width > MAP_MAX_W || map->height > MAP_MAX_H || map->width * map->height > MAP_MAX_CELLS)) return 0;
+	
+	return map;
 }
 
-void draw_map(resource_map_format *map) {
-	char *o = map_data;
-	for (char y = 0; y != map->height; y++) {
-		for (char x = 0; x != map->width; x++) {
-			draw_tile(x << 1, y << 1, *o);
-			o++;
+// See rleCompress() on game-resource.js for the format.
+void rle_decompress(unsigned char *src, char *dst, unsigned int size) {
+	char *end = dst + size;
+	while (dst < end) {
+		unsigned char control = *src;
+		src++;
+		
+		if (control & 0x80) {
+			unsigned char count = (control & 0x7F) + 2;
+			unsigned char value = *src;
+			src++;
+			
+			for (; count && dst != end; count--) {
+				*dst = value;
+				dst++;
+			}
+		} else {
+			for (unsigned char count = control + 1; count && dst != end; count--) {
+				*dst = *src;
+				dst++;
+				src++;
+			}
 		}
 	}
 }
 
+void prepare_map_data(resource_map_format *map) {
+	rle_decompress(map->tiles, map_data, map->height * map->width);
+	clear_floor_tiles(map->height * map->width);
+}
+
 char get_actor_map_x(actor *act) {
 	return act->x >> 4;
 }
 
 char get_actor_map_y(actor *act) {
-	return (act->y - (MAP_SCREEN_Y << 3)) >> 4;
+	return act->y >> 4;
 }
 
 void set_actor_map_xy(actor *act, char x, char y) {
 	act->x = x << 4;
-	act->y = (y << 4) + (MAP_SCREEN_Y << 3);
+	act->y = y << 4;
+}
+
+// Sends a whole screen-wide row of cells; the rows are contiguous in VRAM.
+void draw_map_row(resource_map_format *map, signed char y) {
+	vram_queue_wait_sent(stream_row_mark);
+	
+	signed char x = camera_cell_x;
+	for (char i = VIEW_CELL_W; i; i--) {
+		load_metatile_entries(get_visible_map_tile(map, x, y));
+		unsigned char name_x = get_name_table_x(x);
+		
+		stream_row[0][name_x] = metatile_entries[0];
+		stream_row[0][name_x + 1] = metatile_entries[2];
+		stream_row[1][name_x] = metatile_entries[1];
+		stream_row[1][name_x + 1] = metatile_entries[3];
+		x++;
+	}
+	
+	unsigned char name_y = get_name_table_y(y);
+	vram_queue_copy(XYtoADDR(0, name_y), stream_row[0], sizeof(stream_row[0]));
+	vram_queue_copy(XYtoADDR(0, name_y + 1), stream_row[1], sizeof(stream_row[1]));
+	stream_row_mark = vram_queue_mark();
+}
+
+// Sends a screen-high column of cells.
+void draw_map_column(resource_map_format *map, signed char x) {
+	vram_queue_wait_sent(stream_column_mark);
+	
+	unsigned int *left = stream_column[0];
+	unsigned int *right = stream_column[1];
+	
+	signed char y = camera_cell_y;
+	for (char i = VIEW_CELL_H; i; i--) {
+		load_metatile_entries(get_visible_map_tile(map, x, y));
+		
+		left[0] = metatile_entries[0];
+		left[1] = metatile_entries[1];
+		right[0] = metatile_entries[2];
+		right[1] = metatile_entries[3];
+		left += 2;
+		right += 2;
+		y++;
+	}
+	
+	unsigned char name_x = get_name_table_x(x);
+	unsigned char name_y = get_name_table_y(camera_cell_y);
+	vram_queue_name_column(name_x, name_y, stream_column[0], SCREEN_CHAR_H);
+	vram_queue_name_column(name_x + 1, name_y, stream_column[1], SCREEN_CHAR_H);
+	stream_column_mark = vram_queue_mark();
+}
+
+// Redraws the whole screen, except for the HUD.
+void draw_map(resource_map_format *map) {
+	signed char y = camera_cell_y < 0 ? 0 : camera_cell_y;
+	for (; y != camera_cell_y + VIEW_CELL_H; y++) draw_map_row(map, y);
+}
+
+void set_camera(signed char x, signed char y) {
+	camera_cell_x = x;
+	camera_cell_y = y;
+	
+	// For the actors
+	camera_x = x * 16;
+	camera_y = y * 16;
+}
+
+// Keeps the player at least CAMERA_MARGIN cells away from the edges of the screen, without going past the edges of the map.
+signed char follow_player(signed char camera, signed char player_cell, signed char view_size, signed char map_size) {
+	if (player_cell < camera + CAMERA_MARGIN) camera = player_cell - CAMERA_MARGIN;
+	if (player_cell >= camera + view_size - CAMERA_MARGIN) camera = player_cell - view_size + CAMERA_MARGIN + 1;
+	
+	if (camera > map_size - view_size) camera = map_size - view_size;
+	if (camera < 0) camera = 0;
+	
+	return camera;
+}
+
+void init_camera(resource_map_format *map) {
+	is_map_scrolling = map->width > FIXED_MAP_MAX_W || map->height > FIXED_MAP_MAX_H;
+	
+	if (!is_map_scrolling) {
+		map_row_origin = MAP_SCREEN_Y >> 1;
+		set_camera(0, -map_row_origin);
+		return;
+	}
+	
+	// Start with the player as close to the center as the map allows.
+	signed char player_x = get_actor_map_x(&player);
+	signed char player_y = get_actor_map_y(&player);
+	map_row_origin = 0;
+	set_camera(
+		follow_player(player_x - (VIEW_CELL_W >> 1), player_x, VIEW_CELL_W, map->width),
+		follow_player(player_y - (VIEW_CELL_H >> 1), player_y, VIEW_CELL_H, map->height));
+	scroll_mark = vram_queue_mark();
+}
+
+void move_camera(resource_map_format *map) {
+	if (!is_map_scrolling) return;
+	
+	signed char x = follow_player(camera_cell_x, get_actor_map_x(&player), VIEW_CELL_W, map->width);
+	signed char y = follow_player(camera_cell_y, get_actor_map_y(&player), VIEW_CELL_H, map->height);
+	
+	signed char delta_x = x - camera_cell_x;
+	signed char delta_y = y - camera_cell_y;
+	if (!delta_x && !delta_y) return;
+	
+	set_camera(x, y);
+	
+	// The rest of the screen is just scrolled, so only the newly exposed column or row needs to be sent.
+	if (delta_x == 1 && !delta_y) {
+		draw_map_column(map, x + VIEW_CELL_W - 1);
+	} else if (delta_x == -1 && !delta_y) {
+		draw_map_column(map, x);
+	} else if (delta_y == 1 && !delta_x) {
+		draw_map_row(map, y + VIEW_CELL_H - 1);
+	} else if (delta_y == -1 && !delta_x) {
+		draw_map_row(map, y);
+	} else {
+		draw_map(map);
+	}
+	
+	scroll_mark = vram_queue_mark();
+}
+
+// Must be called during VBlank, right after the VRAM queue is drained. The scroll only follows the camera once
+// the rows or columns drawn for its position have been sent; until then, the previous position is kept.
+void update_scroll() {
+	if (!vram_queue_is_sent(scroll_mark)) return;
+	
+	SMS_setBGScrollX(-(camera_cell_x << 4));
+	SMS_setBGScrollY(get_name_table_y(camera_cell_y) << 3);
+}
+
+void clear_map_changes() {
+	is_map_data_dirty = 0;
+	dirty_cell_count = 0;
+}
+
+void draw_map_changes(resource_map_format *map) {
+	if (is_map_data_dirty) {
+		draw_map(map);
+	} else {
+		map_cell *cell = dirty_cells;
+		for (char i = dirty_cell_count; i; i--) {
+			draw_tile(cell->x, cell->y, get_map_tile(map, cell->x, cell->y));
+			cell++;
+		}
+	}
+	
+	clear_map_changes();
 }
 
 char try_pushing_tile_on_map(resource_map_format *map, char x, char y, signed char delta_x, signed char delta_y) {
@@ -193,23 +777,23 @@ char try_pushing_tile_on_map(resource_map_format *map, char x, char y, signed ch
 		char source_floor_tile = get_floor_tile(map, x, y);
 		
 		set_map_tile(map, x, y, source_floor_tile ? source_floor_tile : 1);
+		set_floor_tile(map, x, y, 0);
 		set_map_tile(map, new_x, new_y, tile_combination);
 		
 		return 1;
 	}
 	
-	unsigned int target_tile_attr = get_tile_attr(target_tile);	
+	unsigned char target_tile_attr = get_tile_attr(target_tile);	
 	
 	if (target_tile_attr & TILE_ATTR_SOLID) return 0;
 
 	char source_floor_tile = get_floor_tile(map, x, y);
 	
 	set_map_tile(map, x, y, source_floor_tile ? source_floor_tile : 1);
+	set_floor_tile(map, x, y, 0);
 	set_map_tile(map, new_x, new_y, source_tile);
 	
 	set_floor_tile(map, new_x, new_y, target_tile);
-
-	is_map_data_dirty = 1;
 	
 	return 1;
 }
@@ -222,8 +806,10 @@ void try_moving_actor_on_map(actor *act, resource_map_format *map, signed char d
 	char new_y = y + delta_y;
 	if (new_x >= map->width || new_y >= map->height) return;
 	
+	undo_begin_move();
+	
 	char tile = get_map_tile(map, new_x, new_y);
-	unsigned int tile_attr = get_tile_attr(tile);	
+	unsigned char tile_attr = get_tile_attr(tile);	
 
 	if (tile_attr & TILE_ATTR_PLAYER_END) stage_clear = 1;
 	
@@ -234,13 +820,49 @@ void try_moving_actor_on_map(actor *act, resource_map_format *map, signed char d
 	}
 	
 	set_actor_map_xy(act, new_x, new_y);
+	
+	undo_commit_move(delta_y ? (delta_y < 0 ? UNDO_DIR_UP : UNDO_DIR_DOWN) : (delta_x < 0 ? UNDO_DIR_LEFT : UNDO_DIR_RIGHT));
+}
+
+// Indexed by UNDO_DIR_*
+const signed char direction_delta_x[] = { 0, 0, -1, 1 };
+const signed char direction_delta_y[] = { -1, 1, 0, 0 };
+
+// The cells store old XOR new, so the same code both undoes and redoes a move.
+void apply_undo_move(actor *act, resource_map_format *map, undo_move *move, signed char sign) {
+	undo_cell *cell = move->cells;
+	for (char i = move->cell_count; i; i--) {
+		char y = cell->y & ~UNDO_LAYER_FLOOR;
+		if (cell->y & UNDO_LAYER_FLOOR) {
+			unsigned int cell_number = y * map->width + cell->x;
+			write_floor_tile(cell_number, read_floor_tile(cell_number) ^ cell->diff);
+		} else {
+			*(get_map_tile_pointer(map, map_data, cell->x, y)) ^= cell->diff;
+			mark_map_cell_dirty(cell->x, y);
+		}
+		cell++;
+	}
+	
+	set_actor_map_xy(act, 
+		get_actor_map_x(act) + sign * direction_delta_x[move->direction], 
+		get_actor_map_y(act) + sign * direction_delta_y[move->direction]);
+}
+
+void undo_actor_move(actor *act, resource_map_format *map) {
+	undo_move *move = undo_pop();
+	if (move) apply_undo_move(act, map, move, -1);
+}
+
+void redo_actor_move(actor *act, resource_map_format *map) {
+	undo_move *move = redo_pop();
+	if (move) apply_undo_move(act, map, move, 1);
 }
 
 void player_find_start(resource_map_format *map) {
-	char *o = map->tiles;
+	char *o = map_data;
 	for (char y = 0; y != map->height; y++) {
 		for (char x = 0; x != map->width; x++) {
-			unsigned int tile_attr = get_tile_attr(*o);
+			unsigned char tile_attr = get_tile_attr(*o);
 			if (tile_attr & TILE_ATTR_PLAYER_START) {
 				set_actor_map_xy(&player, x, y);
 			}
@@ -249,6 +871,87 @@ void player_find_start(resource_map_format *map) {
 	}
 }
 
+#ifdef BENCHMARK
+// Counts how many moves fit in the active display period; each scanline takes 228 CPU cycles.
+// With BENCHMARK_ROM_LOOKUPS also defined, the same figure comes out for the tile lookups on ROM, for comparison.
+void benchmark_moves(resource_map_format *map) {
+	unsigned int moves = 0;
+	
+	SMS_waitForVBlank();
+	while (SMS_getVCount());
+	while (SMS_getVCount() < SCREEN_H) {
+		try_moving_actor_on_map(&player, map, 1, 0);
+		try_moving_actor_on_map(&player, map, -1, 0);
+		moves += 2;
+	}
+	
+	// The moves may have pushed things around.
+	prepare_map_data(map);
+	player_find_start(map);
+	clear_map_changes();
+	undo_clear();
+	
+	if (!moves) return;
+	SMS_setNextTileatXY(2, 4);
+	printf("%u cycles/move", (unsigned int) (SCREEN_H * 228UL / moves));
+}
+
+// Same as benchmark_moves(), for the sprite submission of the player; the SAT buffer is cleared every 16 actors.
+void benchmark_sprites() {
+	unsigned int actors = 0;
+	
+	SMS_waitForVBlank();
+	while (SMS_getVCount());
+	while (SMS_getVCount() < SCREEN_H) {
+		SMS_initSprites();
+		for (char i = 16; i; i--) draw_actor(&player);
+		actors += 16;
+	}
+	SMS_initSprites();
+	
+	SMS_setNextTileatXY(2, 3);
+	printf("%u cycles/actor", (unsigned int) (SCREEN_H * 228UL / actors));
+}
+
+// Measures how many scanlines it takes to decompress the map.
+void benchmark_map_decoding(resource_map_format *map) {
+	SMS_waitForVBlank();
+	while (SMS_getVCount());
+	prepare_map_data(map);
+	unsigned char lines = SMS_getVCount();
+	
+	SMS_setNextTileatXY(2, 5);
+	printf("%u cycles/decode", lines * 228U);
+}
+
+// Average cost of the audio tick, with whatever music is playing; each call advances it by a frame.
+void benchmark_audio() {
+	SMS_waitForVBlank();
+	while (SMS_getVCount());
+	for (char i = 32; i; i--) audio_tick();
+	unsigned char lines = SMS_getVCount();
+	
+	SMS_setNextTileatXY(2, 0);
+	printf("%u cycles/audio tick", (unsigned int) (lines * 228UL / 32));
+}
+
+// Average cost of a named lookup, over 8 calls, and of a level lookup, over 32; shown instead of the controls help.
+void benchmark_resource_find(int map_number) {
+	SMS_waitForVBlank();
+	while (SMS_getVCount());
+	for (char i = 8; i; i--) resource_find("project.inf");
+	unsigned char named_lines = SMS_getVCount();
+	
+	SMS_waitForVBlank();
+	while (SMS_getVCount());
+	for (char i = 32; i; i--) resource_find_level(map_number);
+	unsigned char level_lines = SMS_getVCount();
+	
+	SMS_setNextTileatXY(2, 1);
+	printf("%u cycles/find, %u/level    ", (unsigned int) (named_lines * 228UL / 8), (unsigned int) (level_lines * 228UL / 32));
+}
+#endif
+
 char *skip_after_end_of_string(char *s) {
 	while (*s) s++;
 	return s + 1;
@@ -257,13 +960,15 @@ char *skip_after_end_of_string(char *s) {
 void initialize_graphics() {
 	SMS_waitForVBlank();
 	SMS_displayOff();
-	SMS_disableLineInterrupt();
+	
+	// Display is off, so VRAM can be written at any time.
+	vram_queue_set_direct(1);
 	
 	load_standard_palettes();
 	
 	SMS_VRAMmemsetW(0, 0, 16 * 1024); 
 
-	SMS_load1bppTiles(font_1bpp, 352, font_1bpp_size, 0, 1);
+	SMS_load1bppTiles((void *) font_1bpp, 352, font_1bpp_size, 0, 1);
 	SMS_configureTextRenderer(352 - 32);
 	
 	SMS_mapROMBank(RESOURCE_BANK);
@@ -272,6 +977,59 @@ void initialize_graphics() {
 	SMS_loadSpritePalette(resource_get_pointer(resource_find("main.pal")));
 }
 
+void load_tileset() {
+	// The tileset may have been stored compressed.
+	resource_location_format *compressed_tileset = resource_find("main.pga");
+	if (compressed_tileset) {
+		SMS_loadPSGaidencompressedTiles(resource_get_pointer(compressed_tileset), FIRST_TILESET_TILE);
+	} else {
+		// Copied one tile at a time, so that it doesn't matter if the tileset crosses a page boundary.
+		resource_location_format *tileset = resource_find("main.til");
+		unsigned int tile_count = tileset->size >> 5;
+		if (tile_count > MAX_TILESET_TILES) tile_count = MAX_TILESET_TILES;
+		
+		unsigned char tile[32];
+		for (unsigned int tile_number = 0; tile_number != tile_count; tile_number++) {
+			resource_read(tileset, tile_number << 5, tile, sizeof(tile));
+			SMS_loadTiles(tile, FIRST_TILESET_TILE + tile_number, sizeof(tile));
+		}
+	}
+	
+	// Deduplicated tilesets come with a table telling which tiles each metatile uses, and how they're flipped.
+	resource_location_format *metatiles = resource_find("main.mtl");
+	metatile_table_page = metatiles ? metatiles->page : 0;
+	metatile_table_offset = metatiles ? metatiles->offset : 0;
+}
+
+// Font, palettes and tiles stay on VRAM between levels; only the HUD and the playfield are rewritten.
+void draw_level(resource_map_format *map) {
+	// A blank frame is enough for this; the display is turned off only so the VRAM can be written at full speed.
+	SMS_waitForVBlank();
+	SMS_displayOff();
+	vram_queue_set_direct(1);
+	
+	draw_map(map);
+	update_scroll();
+	
+	// Scrolling maps take the whole screen, so there's no room for the HUD, nor for the profiler's statistics.
+	PROFILE_SHOW_TEXT(!is_map_scrolling);
+	if (!is_map_scrolling) {
+		SMS_VRAMmemsetW(XYtoADDR(0, 0), 0, MAP_SCREEN_Y * SCREEN_CHAR_W * sizeof(unsigned int));
+
+		SMS_setNextTileatXY(2, 1);
+		puts("1:Undo 2:Redo Pause:Skip map");
+
+		SMS_setNextTileatXY(2, 2);
+		puts(map->name);
+
+		SMS_setNextTileatXY(22, 3);
+		puts("next ===>");
+	}
+	
+	SMS_displayOn();
+	vram_queue_set_direct(0);
+}
+
 void wait_button_press() {
 	unsigned int joy;
 	
@@ -293,79 +1051,90 @@ void wait_button_release() {
 }
 
 char gameplay_loop() {
-	unsigned int joy = SMS_getKeysStatus();
-	unsigned int joy_prev = 0;
-	unsigned int joy_delay = 0;
-	
 	int map_number = 1;	
+	audio_resource music, clear_sfx;
+	
+	// Everything here is shared by all the levels.
+	initialize_graphics();
+	load_tileset();
+	load_tile_attrs();
+	load_tile_combinations();
+	
+	load_audio_resource(&music, "music.psg");
+	load_audio_resource(&clear_sfx, "clear.psg");
+	play_music(&music);
 	
 	while (1) {
-		initialize_graphics();
-
-		SMS_loadTiles(resource_get_pointer(resource_find("main.til")), 4, 256 * 32);
-		
-		tile_attrs = resource_find("main.atr");
-		tile_combinations = resource_find("merging.dat");
-		
 		resource_map_format *map = load_map(map_number);
 		if (!map) {
 			map_number = 1;
 			map = load_map(map_number);
 		}
 		prepare_map_data(map);
-		draw_map(map);
-
-		SMS_setNextTileatXY(2, 1);
-		puts("Press button to skip map");
-
-		SMS_setNextTileatXY(2, 2);
-		puts(map->name);
-
-		SMS_setNextTileatXY(22, 3);
-		puts("next ===>");
-		
-
-		SMS_displayOn();
 		
 		init_actor(&player, 32, 32, 2, 1, 8, 2);
 		player_find_start(map);
+		
+		init_camera(map);
+		draw_level(map);
+		
+#ifdef BENCHMARK
+		benchmark_moves(map);
+		benchmark_map_decoding(map);
+		benchmark_sprites();
+		benchmark_audio();
+		benchmark_resource_find(map_number);
+#endif
 
 		stage_clear = 0;
-		is_map_data_dirty = 0;
+		clear_map_changes();
+		undo_clear();
+		input_clear();
+		SMS_resetPauseRequest();
 		
 		do {
-			// Wait button press
-			if (joy_delay) joy_delay--;
-			if (!joy_delay || joy != joy_prev) {
-				char ply_map_x = get_actor_map_x(&player);
-				char ply_map_y = get_actor_map_y(&player);
-				
-				if (joy & PORT_A_KEY_UP) {
-					try_moving_actor_on_map(&player, map, 0, -1);
-				} else if (joy & PORT_A_KEY_DOWN) {
-					try_moving_actor_on_map(&player, map, 0, 1);
-				} else if (joy & PORT_A_KEY_LEFT) {
-					try_moving_actor_on_map(&player, map, -1, 0);
-				} else if (joy & PORT_A_KEY_RIGHT) {
-					try_moving_actor_on_map(&player, map, 1, 0);
-				}
-				
-				joy_delay = 8;
+			PROFILE_BEGIN(PROFILE_INPUT);
+			
+			// At most one move per frame; the rest stay queued for the next ones
+			input_update();
+			switch (input_next_action()) {
+			case INPUT_UP: try_moving_actor_on_map(&player, map, 0, -1); break;
+			case INPUT_DOWN: try_moving_actor_on_map(&player, map, 0, 1); break;
+			case INPUT_LEFT: try_moving_actor_on_map(&player, map, -1, 0); break;
+			case INPUT_RIGHT: try_moving_actor_on_map(&player, map, 1, 0); break;
+			case INPUT_UNDO: undo_actor_move(&player, map); break;
+			case INPUT_REDO: redo_actor_move(&player, map); break;
 			}
 			
+			PROFILE_END(PROFILE_INPUT);
+			
+			PROFILE_BEGIN(PROFILE_ACTORS);
 			SMS_initSprites();
 			draw_actor(&player);
 			SMS_finalizeSprites();	
+			PROFILE_END(PROFILE_ACTORS);
+			
+			PROFILE_BEGIN(PROFILE_MAP);
+			move_camera(map);
+			draw_map_changes(map);
+			PROFILE_END(PROFILE_MAP);
 			
 			SMS_waitForVBlank();
-			SMS_copySpritestoSAT();	
 			
-			if (is_map_data_dirty) draw_map(map);
+			PROFILE_BEGIN(PROFILE_VBLANK);
+			SMS_copySpritestoSAT();	
+			vram_queue_drain();
+			update_scroll();
+			PROFILE_END(PROFILE_VBLANK);
 			
-			joy_prev = joy;
-			joy = SMS_getKeysStatus();
-		} while (!stage_clear && !(joy & (PORT_A_KEY_1 | PORT_A_KEY_2 | PORT_B_KEY_1 | PORT_B_KEY_2)));
+			PROFILE_ADD(PROFILE_AUDIO, audio_tick_lines);
+			PROFILE_FRAME();
+		} while (!stage_clear && !SMS_queryPauseRequested());
 		
+		// Keeps playing while the next level loads
+		if (stage_clear) play_sfx(&clear_sfx);
+		
+		SMS_resetPauseRequest();
 		map_number++;
 
 		wait_button_release();
@@ -378,9 +1147,37 @@ char handle_gameover() {
 	return STATE_START;
 }
 
+// A resource from another version of the editor can't be read at all, so that's shown instead of crashing.
+void check_resource_format() {
+	if (is_resource_format_supported()) return;
+	
+	SMS_displayOff();
+	vram_queue_set_direct(1);
+	
+	load_standard_palettes();
+	SMS_VRAMmemsetW(0, 0, 16 * 1024);
+	SMS_load1bppTiles((void *) font_1bpp, 352, font_1bpp_size, 0, 1);
+	SMS_configureTextRenderer(352 - 32);
+	
+	SMS_setNextTileatXY(2, 10);
+	puts("Unsupported resource format;");
+	SMS_setNextTileatXY(2, 11);
+	puts("this base ROM only reads:");
+	SMS_setNextTileatXY(2, 13);
+	puts(resource_format_tag);
+	
+	SMS_displayOn();
+	while (1) SMS_waitForVBlank();
+}
+
 char handle_title() {
+	audio_resource music;
+	
 	initialize_graphics();
 	
+	load_audio_resource(&music, "title.psg");
+	play_music(&music);
+	
 	char *app_name = resource_get_pointer(resource_find("project.inf"));
 	char *app_version = skip_after_end_of_string(app_name);
 	char *project_name = skip_after_end_of_string(app_version);
@@ -395,6 +1192,7 @@ char handle_title() {
 	puts("Press any button to start");
 	
 	SMS_displayOn();
+	vram_queue_set_direct(0);
 	
 	wait_button_press();
 	wait_button_release();
@@ -405,6 +1203,10 @@ char handle_title() {
 void main() {
 	char state = STATE_START;
 	
+	vram_queue_init();
+	check_resource_format();
+	audio_init();
+	
 	SMS_useFirstHalfTilesforSprites(1);
 	SMS_setSpriteMode(SPRITEMODE_TALL);
 	
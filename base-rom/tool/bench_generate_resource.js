@@ -0,0 +1,110 @@
+'use strict';
+
+/*
+ * Times the generation of the resource image by game-resource.js for synthetic projects
+ * with 10, 100 and 1000 levels, the way the editor does it when building a ROM.
+ *
+ * Other versions of the generator can be given, to compare them; for instance, one saved with
+ * "git show <commit>:game-resource.js > old-game-resource.js".
+ *
+ * Usage: node tool/bench_generate_resource.js [game-resource.js ...]
+ */
+
+const fs = require('fs');
+const path = require('path');
+const vm = require('vm');
+
+const LEVEL_COUNTS = [10, 100, 1000];
+const MAP_WIDTH = 16;
+const MAP_HEIGHT = 12;
+const MIN_RUN_MS = 500;
+
+// Older versions of the generator use underscore.js, which the editor provides
+const underscoreShim = {
+	flatten: arr => arr.flat(Infinity),
+	sortBy: (arr, key) => {
+		const keyOf = typeof key === 'function' ? key : (o => o[key]);
+		return arr.map((value, idx) => ({ value, idx, sortKey: keyOf(value) }))
+			.sort((a, b) => a.sortKey < b.sortKey ? -1 : a.sortKey > b.sortKey ? 1 : a.idx - b.idx)
+			.map(({ value }) => value);
+	}
+};
+
+const quietConsole = { ...console, log: () => {}, info: () => {}, table: () => {}, groupCollapsed: () => {}, groupEnd: () => {} };
+
+const loadGenerator = file => {
+	const window = {};
+	vm.runInNewContext(fs.readFileSync(file, 'utf8'), { window, _: underscoreShim, console: quietConsole });
+	return window.gameResource;
+};
+
+// Deterministic pseudo-random numbers, so that every run and every generator sees the same project
+const createRandom = seed => () => {
+	seed = (seed * 1103515245 + 12345) & 0x7FFFFFFF;
+	return seed / 0x80000000;
+};
+
+const createProject = levelCount => {
+	const random = createRandom(levelCount);
+	const tileSetW = 16, tileSetH = 16;
+
+	const tiles = Array.from({ length: tileSetW * tileSetH }, (_, idx) => ({
+		pixels: Array.from({ length: 8 }, (_, row) => Array.from({ length: 8 }, (_, col) => (idx + row * col) & 15))
+	}));
+
+	// Walls around, mostly floor inside, with a few scattered tiles, like a typical level
+	const maps = Array.from({ length: levelCount }, (_, idx) => ({
+		id: idx + 1,
+		name: `Level ${idx + 1}`,
+		tileIndexes: Array.from({ length: MAP_HEIGHT }, (_, row) => Array.from({ length: MAP_WIDTH }, (_, col) => {
+			if (!row || !col || row === MAP_HEIGHT - 1 || col === MAP_WIDTH - 1) return 4;
+			return random() < 0.2 ? 1 + Math.floor(random() * 60) : 1;
+		}))
+	}));
+
+	return {
+		tool: { name: 'SMS-Puzzle-Maker', version: 'bench', format: '0.1.0' },
+		projectInfo: { name: 'Benchmark' },
+		options: { mapWidth: MAP_WIDTH, mapHeight: MAP_HEIGHT },
+		maps,
+		tileSet: {
+			attributes: Array.from({ length: 64 }, (_, idx) => ({ isSolid: idx === 3, isPlayerStart: idx === 1, isPlayerEnd: idx === 2, isPushable: idx === 4 })),
+			combinations: [{ sourceTile: 5, destTile: 3, resultTile: 6 }, { sourceTile: 5, destTile: 2, resultTile: 7 }],
+			forMasterSystem: {
+				palettes: [Array.from({ length: 16 }, (_, idx) => [idx * 16, idx * 8, idx * 4])],
+				mapW: tileSetW,
+				mapH: tileSetH,
+				tiles
+			}
+		}
+	};
+};
+
+const timeGeneration = (gameResource, project) => {
+	// Warm up, then repeat until the timing is meaningful
+	const size = gameResource.generateInternalFileSystem(project).length;
+
+	let runs = 0;
+	const start = process.hrtime.bigint();
+	let elapsedMs;
+	do {
+		gameResource.generateInternalFileSystem(project);
+		runs++;
+		elapsedMs = Number(process.hrtime.bigint() - start) / 1e6;
+	} while (elapsedMs < MIN_RUN_MS);
+
+	return { size, ms: elapsedMs / runs };
+};
+
+const generatorFiles = process.argv.length > 2 ? process.argv.slice(2) : [path.join(__dirname, '..', '..', 'game-resource.js')];
+const projects = LEVEL_COUNTS.map(createProject);
+
+generatorFiles.forEach(file => {
+	const gameResource = loadGenerator(file);
+	console.log(file);
+	projects.forEach((project, idx) => {
+		const { size, ms } = timeGeneration(gameResource, project);
+		console.log(`  ${LEVEL_COUNTS[idx].toString().padStart(5)} levels: ${ms.toFixed(2).padStart(9)} ms  ` +
+			`(${(ms * 1000 / LEVEL_COUNTS[idx]).toFixed(1).padStart(7)} us/level, ${size} bytes)`);
+	});
+});
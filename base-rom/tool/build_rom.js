@@ -0,0 +1,270 @@
+'use strict';
+
+/*
+ * Builds a ROM from a project file saved by the editor, without a browser; meant for CI and for big packs.
+ *
+ * The files are generated by game-resource.js, same as on the editor. Each level file, and the set of
+ * files that come from the tileset, is kept on a cache indexed by a hash of its inputs and of the
+ * generator itself, so that only the levels that changed get encoded again; those are split among
+ * worker threads. If the output ROM already holds the same base ROM, only the pages of the resource
+ * that changed are written to it.
+ *
+ * Usage: node tool/build_rom.js <project.json> [options]
+ *
+ *   -o, --output <file>     ROM to write or patch (default: the project name, with .sms)
+ *   --base <file>           base ROM (default: dist/puzzle_maker_base_rom.sms)
+ *   --resource <file>       also write the resource image on its own
+ *   --no-rom                only write the resource image; no base ROM is needed then
+ *   --add <file>            also store this file on the resource, under its own name; for instance, the songs
+ *                           and sound effects the base ROM looks for: title.psg, music.psg and clear.psg, of up
+ *                           to 16 KB each
+ *   --cache <dir>           cache directory (default: .puzzle-maker-cache, next to the project)
+ *   --no-cache              neither read nor write the cache
+ *   -j, --jobs <n>          worker threads for the levels (default: one per CPU; 1 encodes them inline)
+ *   -v, --verbose           show the generator's own report
+ */
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const vm = require('vm');
+const crypto = require('crypto');
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+
+const GENERATOR_FILE = path.join(__dirname, '..', '..', 'game-resource.js');
+const DEFAULT_BASE_ROM = path.join(__dirname, '..', 'dist', 'puzzle_maker_base_rom.sms');
+const PAGE_SIZE = 16 * 1024;
+
+// Below this many levels to encode, starting workers costs more than it saves
+const MIN_LEVELS_PER_WORKER = 32;
+
+const quietConsole = { ...console, log: () => {}, info: () => {}, table: () => {}, groupCollapsed: () => {}, groupEnd: () => {} };
+
+const loadGenerator = (source, verbose) => {
+	const window = {};
+	vm.runInNewContext(source, { window, console: verbose ? console : quietConsole });
+	return window.gameResource;
+};
+
+if (!isMainThread) {
+	// Worker: encodes the levels it's given, and sends them back as they are done
+	const gameResource = loadGenerator(workerData.generatorSource, false);
+	parentPort.on('message', ({ jobs }) => {
+		const results = jobs.map(({ idx, options, map }) => ({ idx, content: Uint8Array.from(gameResource.generateMapFile(options, map).content) }));
+		parentPort.postMessage(results, results.map(({ content }) => content.buffer));
+	});
+	return;
+}
+
+const parseArgs = argv => {
+	const args = { jobs: os.cpus().length, cache: true, extraFiles: [] };
+	for (let idx = 0; idx < argv.length; idx++) {
+		const arg = argv[idx];
+		const value = () => {
+			if (idx + 1 >= argv.length) throw new Error(`${arg} needs a value`);
+			return argv[++idx];
+		};
+
+		switch (arg) {
+			case '-o': case '--output': args.output = value(); break;
+			case '--base': args.base = value(); break;
+			case '--resource': args.resource = value(); break;
+			case '--add': args.extraFiles.push(value()); break;
+			case '--no-rom': args.noROM = true; break;
+			case '--cache': args.cacheDir = value(); break;
+			case '--no-cache': args.cache = false; break;
+			case '-j': case '--jobs': args.jobs = Math.max(1, parseInt(value()) || 1); break;
+			case '-v': case '--verbose': args.verbose = true; break;
+			default:
+				if (arg.startsWith('-') || args.project) throw new Error(`Unexpected argument: ${arg}`);
+				args.project = arg;
+		}
+	}
+
+	if (!args.project) throw new Error('Usage: node tool/build_rom.js <project.json> [-o output.sms] [--base base.sms] [--resource file] [--no-rom] [--add file ...] [--cache dir | --no-cache] [-j jobs] [-v]');
+	if (args.noROM && !args.resource) throw new Error('--no-rom needs --resource');
+	return args;
+};
+
+const hashOf = (...parts) => {
+	const hash = crypto.createHash('sha1');
+	parts.forEach(part => hash.update(typeof part === 'string' ? part : JSON.stringify(part)));
+	return hash.digest('hex');
+};
+
+const createCache = (dir, enabled) => {
+	if (enabled) fs.mkdirSync(dir, { recursive: true });
+
+	const fileFor = key => path.join(dir, key);
+	return {
+		get: key => {
+			if (!enabled) return null;
+			try {
+				return fs.readFileSync(fileFor(key));
+			} catch (e) {
+				return null;
+			}
+		},
+		put: (key, content) => {
+			if (!enabled) return;
+			// Written under a temporary name first, so that an interrupted build can't leave a truncated entry
+			const tempFile = fileFor(`${key}.${process.pid}.tmp`);
+			fs.writeFileSync(tempFile, content);
+			fs.renameSync(tempFile, fileFor(key));
+		}
+	};
+};
+
+// The files that come from the tileset, for a project with no levels, are stored together as JSON
+const generateTileSetFiles = (gameResource, project, generatorHash, cache) => {
+	const { tool, projectInfo, options, tileSet } = project;
+	const key = 'tileset-' + hashOf(generatorHash, { tool, projectInfo, options, tileSet: { ...tileSet, src: undefined } });
+
+	const cached = cache.get(key);
+	if (cached) {
+		const files = JSON.parse(cached.toString());
+		return { fromCache: true, files: Object.fromEntries(Object.entries(files).map(([name, base64]) => [name, Buffer.from(base64, 'base64')])) };
+	}
+
+	const files = Object.fromEntries(Object.entries(gameResource.generateInternalFiles({ ...project, maps: [] }))
+		.map(([name, content]) => [name, Uint8Array.from(content)]));
+	cache.put(key, JSON.stringify(Object.fromEntries(Object.entries(files).map(([name, content]) => [name, Buffer.from(content).toString('base64')]))));
+
+	return { fromCache: false, files };
+};
+
+const encodeInWorkers = (jobs, workerCount, generatorSource) => new Promise((resolve, reject) => {
+	const results = [];
+	let pending = workerCount;
+	const batchSize = Math.ceil(jobs.length / workerCount);
+
+	for (let w = 0; w < workerCount; w++) {
+		const batch = jobs.slice(w * batchSize, (w + 1) * batchSize);
+		const worker = new Worker(__filename, { workerData: { generatorSource } });
+		worker.on('error', reject);
+		worker.on('message', batchResults => {
+			results.push(...batchResults);
+			worker.terminate();
+			if (!--pending) resolve(results);
+		});
+		worker.postMessage({ jobs: batch });
+	}
+});
+
+const generateLevelFiles = async (gameResource, project, generatorHash, generatorSource, cache, jobCount) => {
+	const { mapWidth, mapHeight } = project.options;
+	const options = { mapWidth, mapHeight };
+
+	const contents = [];
+	const jobs = [];
+	project.maps.forEach(({ id, name, tileIndexes }, idx) => {
+		const map = { id, name, tileIndexes };
+		const key = 'level-' + hashOf(generatorHash, options, map);
+		const cached = cache.get(key);
+		if (cached) {
+			contents[idx] = cached;
+		} else {
+			jobs.push({ idx, key, options, map });
+		}
+	});
+
+	const workerCount = Math.min(jobCount, Math.floor(jobs.length / MIN_LEVELS_PER_WORKER));
+	const results = workerCount > 1
+		? await encodeInWorkers(jobs.map(({ idx, options, map }) => ({ idx, options, map })), workerCount, generatorSource)
+		: jobs.map(({ idx, options, map }) => ({ idx, content: Uint8Array.from(gameResource.generateMapFile(options, map).content) }));
+
+	const keys = Object.fromEntries(jobs.map(({ idx, key }) => [idx, key]));
+	results.forEach(({ idx, content }) => {
+		contents[idx] = content;
+		cache.put(keys[idx], content);
+	});
+
+	return {
+		encodedCount: jobs.length,
+		workerCount: workerCount > 1 ? workerCount : 0,
+		files: Object.fromEntries(contents.map((content, idx) => [gameResource.levelFileName(idx + 1), content]))
+	};
+};
+
+// Rewrites only the pages of the resource that differ; returns how many were written, or null if the whole ROM had to be
+const writeROM = (outputFile, baseROM, resource) => {
+	const rom = Buffer.concat([baseROM, resource]);
+
+	let existing = null;
+	try {
+		existing = fs.readFileSync(outputFile);
+	} catch (e) {
+		// Not built yet
+	}
+
+	if (!existing || existing.length < baseROM.length || !existing.subarray(0, baseROM.length).equals(baseROM)) {
+		fs.writeFileSync(outputFile, rom);
+		return null;
+	}
+
+	const fd = fs.openSync(outputFile, 'r+');
+	let pagesWritten = 0;
+	try {
+		for (let offset = 0; offset < resource.length; offset += PAGE_SIZE) {
+			const page = resource.subarray(offset, offset + PAGE_SIZE);
+			const position = baseROM.length + offset;
+			if (!page.equals(existing.subarray(position, position + page.length))) {
+				fs.writeSync(fd, page, 0, page.length, position);
+				pagesWritten++;
+			}
+		}
+		if (existing.length !== rom.length) fs.ftruncateSync(fd, rom.length);
+	} finally {
+		fs.closeSync(fd);
+	}
+
+	return pagesWritten;
+};
+
+const main = async () => {
+	const args = parseArgs(process.argv.slice(2));
+	const startTime = process.hrtime.bigint();
+
+	const project = JSON.parse(fs.readFileSync(args.project, 'utf8'));
+	const generatorSource = fs.readFileSync(GENERATOR_FILE, 'utf8');
+	const generatorHash = hashOf(generatorSource);
+	const gameResource = loadGenerator(generatorSource, args.verbose);
+
+	const projectBaseName = path.basename(args.project).replace(/(\.project)?\.json$/, '');
+	const outputFile = args.output || path.join(path.dirname(args.project), projectBaseName + '.sms');
+	const cache = createCache(args.cacheDir || path.join(path.dirname(args.project), '.puzzle-maker-cache'), args.cache);
+
+	gameResource.checkMaps(project);
+	const tileSetFiles = generateTileSetFiles(gameResource, project, generatorHash, cache);
+	const levelFiles = await generateLevelFiles(gameResource, project, generatorHash, generatorSource, cache, args.jobs);
+
+	// The resource directory only has room for names of up to 13 characters
+	const extraFiles = Object.fromEntries(args.extraFiles.map(file => {
+		const name = path.basename(file);
+		if (name.length > 13) throw new Error(`${file}: the name must have at most 13 characters`);
+		return [name, fs.readFileSync(file)];
+	}));
+
+	const resource = Buffer.from(gameResource.packInternalFileSystem({ ...tileSetFiles.files, ...levelFiles.files, ...extraFiles }));
+	if (args.resource) fs.writeFileSync(args.resource, resource);
+
+	let pagesWritten = 0;
+	if (!args.noROM) {
+		const baseROM = fs.readFileSync(args.base || DEFAULT_BASE_ROM);
+		gameResource.checkBaseROM(baseROM);
+		pagesWritten = writeROM(outputFile, baseROM, resource);
+	}
+
+	const elapsedMs = Number(process.hrtime.bigint() - startTime) / 1e6;
+	console.log(`${project.maps.length} level(s): ${levelFiles.encodedCount} encoded` +
+		(levelFiles.workerCount ? ` on ${levelFiles.workerCount} worker(s)` : '') +
+		`, ${project.maps.length - levelFiles.encodedCount} from cache; tileset ${tileSetFiles.fromCache ? 'from cache' : 'encoded'}.`);
+	console.log(`Resource: ${resource.length} bytes (${resource.length / PAGE_SIZE} page(s)); ` +
+		(args.noROM ? `wrote ${args.resource}` : pagesWritten === null ? `wrote ${outputFile}` : `patched ${pagesWritten} page(s) of ${outputFile}`) +
+		` in ${elapsedMs.toFixed(0)} ms.`);
+};
+
+main().catch(e => {
+	console.error(e.message);
+	process.exit(1);
+});
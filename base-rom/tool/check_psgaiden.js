@@ -0,0 +1,186 @@
+'use strict';
+
+/*
+ * Checks the PSGaiden tileset compression of game-resource.js: the compressed tileset is decoded
+ * the way SMS_loadPSGaidencompressedTiles() does, and has to match the uncompressed one byte for byte.
+ *
+ * Without arguments, a synthetic tileset is used, with solid, striped and noisy tiles, so that every
+ * method the encoder generates comes up; projects saved by the editor can be given instead.
+ *
+ * Since the decoder here was written along with the encoder, both are also checked against vectors:
+ * compressed data with the tiles it has to decode to. SPEC_VECTOR is written by hand from the format
+ * description, not from the encoder. Files made by another compressor, such as BMP2Tile's PSGaiden
+ * one, go on host/check/psgaiden as name.pga, with the uncompressed tiles as name.til; the decoder must
+ * get the tiles back, and the encoder has to produce data that decodes to them too; for SPEC_VECTOR,
+ * the very same bytes.
+ *
+ * Usage: node tool/check_psgaiden.js [project.json ...]
+ */
+
+const fs = require('fs');
+const path = require('path');
+const vm = require('vm');
+
+const TILE_SIZE = 32;
+
+const VECTOR_DIR = path.join(__dirname, '..', 'host', 'check', 'psgaiden');
+
+// Tile count, then per tile a method byte, 2 bits per bitplane with bitplane 0 on bits 7-6:
+// %00 for all 0x00, %01 for all 0xFF, %10 for 8 raw bytes, one per line; the raw bytes follow the method byte.
+const SPEC_VECTOR = {
+	name: 'spec',
+	compressed: Uint8Array.from([
+		0x03, 0x00,
+		// Bitplanes 0x00, 0xFF, raw, 0x00
+		0x18, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+		// Bitplanes raw, 0x00, 0x00, 0xFF
+		0x81, 0x81, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x81,
+		// Every bitplane 0xFF
+		0x55
+	]),
+	// 4 bytes per line, one per bitplane
+	tiles: Uint8Array.from([
+		...[0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80].flatMap(b => [0x00, 0xFF, b, 0x00]),
+		...[0x81, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x81].flatMap(b => [b, 0x00, 0x00, 0xFF]),
+		...new Array(TILE_SIZE).fill(0xFF)
+	])
+};
+
+const quietConsole = { ...console, log: () => {}, info: () => {}, table: () => {}, groupCollapsed: () => {}, groupEnd: () => {} };
+
+const loadGenerator = file => {
+	const window = {};
+	vm.runInNewContext(fs.readFileSync(file, 'utf8'), { window, console: quietConsole });
+	return window.gameResource;
+};
+
+// Deterministic pseudo-random numbers, so that a failure can be reproduced
+const createRandom = seed => () => {
+	seed = (seed * 1103515245 + 12345) & 0x7FFFFFFF;
+	return seed / 0x80000000;
+};
+
+const createProject = () => {
+	const random = createRandom(1);
+	const tileSetW = 16, tileSetH = 16;
+
+	// A quarter of the tiles are solid colors, so every combination of all 0x00 and all 0xFF bitplanes shows up
+	const pixelAt = (idx, row, col) => {
+		switch (idx & 3) {
+		case 0: return (idx >> 2) & 15;
+		case 1: return row & 1 ? idx & 15 : 0;
+		case 2: return col < 4 ? 15 : 0;
+		default: return Math.floor(random() * 16);
+		}
+	};
+
+	const tiles = Array.from({ length: tileSetW * tileSetH }, (_, idx) => ({
+		pixels: Array.from({ length: 8 }, (_, row) => Array.from({ length: 8 }, (_, col) => pixelAt(idx, row, col)))
+	}));
+
+	return {
+		tool: { name: 'SMS-Puzzle-Maker', version: 'check', format: '0.1.0' },
+		projectInfo: { name: 'PSGaiden check', compressTileSet: true },
+		options: { mapWidth: 16, mapHeight: 12 },
+		maps: [],
+		tileSet: {
+			attributes: Array.from({ length: 64 }, () => ({})),
+			combinations: [],
+			forMasterSystem: {
+				palettes: [Array.from({ length: 16 }, (_, idx) => [idx * 16, idx * 8, idx * 4])],
+				mapW: tileSetW,
+				mapH: tileSetH,
+				tiles
+			}
+		}
+	};
+};
+
+// Same as SMS_loadPSGaidencompressedTilesatAddr(), for the methods the encoder generates
+const psgaidenDecompress = src => {
+	const tileCount = src[0] | src[1] << 8;
+	const output = new Uint8Array(tileCount * TILE_SIZE);
+	let position = 2;
+
+	for (let tileOffset = 0; tileOffset < output.length; tileOffset += TILE_SIZE) {
+		const methods = src[position++];
+		for (let planeIdx = 0; planeIdx < 4; planeIdx++) {
+			const method = (methods >> (6 - planeIdx * 2)) & 0x03;
+			const planeAt = line => tileOffset + line * 4 + planeIdx;
+
+			if (method === 0 || method === 1) {
+				for (let line = 0; line < 8; line++) output[planeAt(line)] = method ? 0xFF : 0x00;
+			} else if (method === 2) {
+				for (let line = 0; line < 8; line++) output[planeAt(line)] = src[position++];
+			} else {
+				throw new Error(`tile ${tileOffset / TILE_SIZE} uses method 3, which the encoder shouldn't generate`);
+			}
+		}
+	}
+
+	if (position !== src.length) throw new Error(`${src.length - position} bytes left after the last tile`);
+	return output;
+};
+
+const checkProject = (gameResource, name, project) => {
+	project.projectInfo.compressTileSet = true;
+	const obj = gameResource.generateObj(project);
+	if (!obj.compressedTileSet) {
+		console.log(`${name}: compression doesn't help with this tileset; nothing to check`);
+		return true;
+	}
+
+	const decoded = psgaidenDecompress(obj.compressedTileSet);
+	const mismatch = decoded.length !== obj.tileSet.length ? 0 : decoded.findIndex((b, idx) => b !== obj.tileSet[idx]);
+	if (mismatch !== -1) {
+		console.log(`${name}: FAIL, tile ${Math.floor(mismatch / TILE_SIZE)} decodes differently ` +
+			`(${decoded.length} bytes decoded, ${obj.tileSet.length} expected)`);
+		return false;
+	}
+
+	console.log(`${name}: ok, ${obj.tileSet.length / TILE_SIZE} tiles, ${obj.tileSet.length} => ${obj.compressedTileSet.length} bytes`);
+	return true;
+};
+
+const sameBytes = (a, b) => a.length === b.length && a.every((byte, idx) => byte === b[idx]);
+
+const loadVectors = () => {
+	const files = fs.existsSync(VECTOR_DIR) ? fs.readdirSync(VECTOR_DIR).filter(file => file.endsWith('.pga')).sort() : [];
+	return [SPEC_VECTOR, ...files.map(file => ({
+		name: file,
+		compressed: new Uint8Array(fs.readFileSync(path.join(VECTOR_DIR, file))),
+		tiles: new Uint8Array(fs.readFileSync(path.join(VECTOR_DIR, file.replace(/\.pga$/, '.til'))))
+	}))];
+};
+
+const checkVector = (gameResource, { name, compressed, tiles }) => {
+	if (!sameBytes(psgaidenDecompress(compressed), tiles)) {
+		console.log(`vector ${name}: FAIL, the decoder doesn't get the tiles back`);
+		return false;
+	}
+
+	// Other compressors may choose other methods, but the result must decode to the same tiles
+	const encoded = gameResource.psgaidenCompress(tiles);
+	if (!sameBytes(psgaidenDecompress(encoded), tiles)) {
+		console.log(`vector ${name}: FAIL, the encoder's output doesn't decode to the tiles`);
+		return false;
+	}
+	if (name === SPEC_VECTOR.name && !sameBytes(encoded, compressed)) {
+		console.log(`vector ${name}: FAIL, the encoder doesn't produce the vector`);
+		return false;
+	}
+
+	console.log(`vector ${name}: ok, ${tiles.length / TILE_SIZE} tiles`);
+	return true;
+};
+
+const gameResource = loadGenerator(path.join(__dirname, '..', '..', 'game-resource.js'));
+const projects = process.argv.length > 2 ?
+	process.argv.slice(2).map(file => [file, JSON.parse(fs.readFileSync(file, 'utf8'))]) :
+	[['synthetic', createProject()]];
+
+const results = [
+	...loadVectors().map(vector => checkVector(gameResource, vector)),
+	...projects.map(([name, project]) => checkProject(gameResource, name, project))
+];
+process.exit(results.every(ok => ok) ? 0 : 1);
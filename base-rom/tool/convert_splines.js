@@ -0,0 +1,110 @@
+'use strict';
+
+/*
+ * Converts a spline into the delta-encoded path format read by next_path_delta() (see actor.h):
+ * 2 byte segments holding a packed x/y delta and its repeat count, ended by a count of 0.
+ *
+ * The input is a JSON file with the control points, in pixels, of a Catmull-Rom spline that
+ * goes through all of them:
+ *
+ *     { "points": [[0, 0], [32, 0], [32, 32]], "closed": true }
+ *
+ * The curve is sampled into one pixel steps, so a path speed of FIXED(1) is about one pixel
+ * per frame; an open path jumps back to its first point when it starts over.
+ *
+ * Usage: node tool/convert_splines.js <input.spline.json> <output.path>
+ */
+
+const fs = require('fs');
+
+const MAX_DELTA = 7;
+const MIN_DELTA = -8;
+const MAX_REPEAT = 255;
+const SAMPLES_PER_PIXEL = 8;
+
+const [inputFile, outputFile] = process.argv.slice(2);
+if (!inputFile || !outputFile) {
+	console.error('Usage: node tool/convert_splines.js <input.spline.json> <output.path>');
+	process.exit(1);
+}
+
+const spline = JSON.parse(fs.readFileSync(inputFile, 'utf8'));
+const points = spline.points || [];
+const closed = !!spline.closed;
+if (points.length < 2) {
+	console.error(`${inputFile}: a spline needs at least 2 points`);
+	process.exit(1);
+}
+
+const pointAt = idx => closed
+	? points[(idx + points.length) % points.length]
+	: points[Math.max(0, Math.min(points.length - 1, idx))];
+
+const catmullRom = (p0, p1, p2, p3, t) => {
+	const t2 = t * t;
+	const t3 = t2 * t;
+	return 0.5 * ((2 * p1) + (-p0 + p2) * t + (2 * p0 - 5 * p1 + 4 * p2 - p3) * t2 + (-p0 + 3 * p1 - 3 * p2 + p3) * t3);
+};
+
+// Whole pixel positions along the curve, without repeats
+const positions = [];
+const addPosition = (x, y) => {
+	const last = positions[positions.length - 1];
+	if (!last || last[0] !== x || last[1] !== y) positions.push([x, y]);
+};
+
+const segmentCount = closed ? points.length : points.length - 1;
+for (let seg = 0; seg !== segmentCount; seg++) {
+	const [p0, p1, p2, p3] = [pointAt(seg - 1), pointAt(seg), pointAt(seg + 1), pointAt(seg + 2)];
+	const length = Math.hypot(p2[0] - p1[0], p2[1] - p1[1]);
+	const samples = Math.max(1, Math.ceil(length * SAMPLES_PER_PIXEL));
+
+	for (let i = 0; i !== samples; i++) {
+		const t = i / samples;
+		addPosition(Math.round(catmullRom(p0[0], p1[0], p2[0], p3[0], t)), Math.round(catmullRom(p0[1], p1[1], p2[1], p3[1], t)));
+	}
+}
+if (closed) {
+	addPosition(Math.round(points[0][0]), Math.round(points[0][1]));
+} else {
+	const last = points[points.length - 1];
+	addPosition(Math.round(last[0]), Math.round(last[1]));
+	// Starting over means going back to the first point
+	addPosition(Math.round(points[0][0]), Math.round(points[0][1]));
+}
+
+// Steps between consecutive positions, split so that each one fits on a nibble
+const steps = [];
+for (let i = 1; i !== positions.length; i++) {
+	let dx = positions[i][0] - positions[i - 1][0];
+	let dy = positions[i][1] - positions[i - 1][1];
+	while (dx || dy) {
+		const sx = Math.max(MIN_DELTA, Math.min(MAX_DELTA, dx));
+		const sy = Math.max(MIN_DELTA, Math.min(MAX_DELTA, dy));
+		steps.push([sx, sy]);
+		dx -= sx;
+		dy -= sy;
+	}
+}
+
+if (!steps.length) {
+	console.error(`${inputFile}: the spline doesn't move`);
+	process.exit(1);
+}
+
+// Runs of the same step become a single segment
+const bytes = [];
+for (let i = 0; i !== steps.length;) {
+	const [dx, dy] = steps[i];
+	let count = 1;
+	while (i + count !== steps.length && count !== MAX_REPEAT && steps[i + count][0] === dx && steps[i + count][1] === dy) count++;
+
+	bytes.push(((dx & 0x0F) << 4) | (dy & 0x0F), count);
+	i += count;
+}
+bytes.push(0, 0);
+
+fs.writeFileSync(outputFile, Buffer.from(bytes));
+
+// The old format took 2 bytes per step, plus the terminator
+console.log(`${outputFile}: ${steps.length} steps, ${bytes.length} bytes (${steps.length * 2 + 2} as one step per entry)`);
@@ -0,0 +1,266 @@
+'use strict';
+
+/*
+ * Reports where the ROM and RAM go: each file of a resource pack with its page, offset and size, how much of
+ * each page is left as padding, and, from the linker map of the base ROM, how much code, constant data and RAM
+ * each module takes, against the 32KB that come before the resource pages and the 8KB of RAM.
+ *
+ * The resource can be given on its own, as written by the editor or by tool/build_rom.js --resource, or as part
+ * of a full ROM. The text report goes to stdout; --json also writes the same figures as JSON, for tracking them
+ * across builds.
+ *
+ * Usage: node tool/footprint_report.js [--resource <file.resource.bin | rom.sms>] [--map <puzzle_maker_base_rom.map>] [--json <file>]
+ */
+
+const fs = require('fs');
+
+const PAGE_SIZE = 16 * 1024;
+
+// Same as RESOURCE_BANK on the base ROM; everything before it is the base ROM itself
+const RESOURCE_BANK = 2;
+const BASE_ROM_SIZE = RESOURCE_BANK * PAGE_SIZE;
+
+const RAM_START = 0xC000;
+const RAM_SIZE = 8 * 1024;
+
+// See packFiles() on game-resource.js
+const HEADER_SIZE = 4 + 2 + 2;
+const FILE_NAME_SIZE = 14;
+const NAMED_ENTRY_SIZE = FILE_NAME_SIZE + 2 + 2 + 2;
+const LEVEL_ENTRY_SIZE = 2 + 2 + 2;
+
+// Same as RESOURCE_FORMAT_VERSION on game-resource.js; it's the last byte of the signature
+const RESOURCE_FORMAT_VERSION = 1;
+
+// Linker areas holding constant data; the other ones below RAM_START are counted as code
+const CONST_AREAS = ['_RODATA', '_INITIALIZER', '_CONST', '_LIT'];
+
+const TOP_SYMBOL_COUNT = 10;
+
+const parseArgs = argv => {
+	const args = {};
+	for (let idx = 0; idx < argv.length; idx++) {
+		const arg = argv[idx];
+		const value = () => {
+			if (idx + 1 >= argv.length) throw new Error(`${arg} needs a value`);
+			return argv[++idx];
+		};
+
+		switch (arg) {
+			case '--resource': args.resource = value(); break;
+			case '--map': args.map = value(); break;
+			case '--json': args.json = value(); break;
+			default: throw new Error(`Unexpected argument: ${arg}`);
+		}
+	}
+
+	if (!args.resource && !args.map) throw new Error('Usage: node tool/footprint_report.js [--resource file] [--map file] [--json file]');
+	return args;
+};
+
+// A resource image starts with the directory; on a ROM, that's at the start of RESOURCE_BANK
+const findResource = image => {
+	const hasSignature = offset => image.length >= offset + HEADER_SIZE && image.toString('latin1', offset, offset + 3) === 'rsc';
+	if (hasSignature(0)) return image;
+	if (hasSignature(BASE_ROM_SIZE)) return image.subarray(BASE_ROM_SIZE);
+	throw new Error(`No resource directory at offset 0 or ${BASE_ROM_SIZE}`);
+};
+
+const analyzeResource = (file, image) => {
+	const resource = findResource(image);
+	const fileCount = resource.readUInt16LE(4);
+	const levelCount = resource.readUInt16LE(6);
+	const directorySize = HEADER_SIZE + fileCount * NAMED_ENTRY_SIZE + levelCount * LEVEL_ENTRY_SIZE;
+
+	const readLocation = offset => ({
+		page: resource.readUInt16LE(offset),
+		size: resource.readUInt16LE(offset + 2),
+		offset: resource.readUInt16LE(offset + 4)
+	});
+
+	const files = [{ name: '(directory)', page: RESOURCE_BANK, size: directorySize, offset: 0 }];
+	for (let idx = 0; idx < fileCount; idx++) {
+		const entryOffset = HEADER_SIZE + idx * NAMED_ENTRY_SIZE;
+		const name = resource.toString('latin1', entryOffset, entryOffset + FILE_NAME_SIZE).replace(/\0.*$/, '');
+		files.push({ name, ...readLocation(entryOffset + FILE_NAME_SIZE) });
+	}
+	const levelTableOffset = HEADER_SIZE + fileCount * NAMED_ENTRY_SIZE;
+	for (let idx = 0; idx < levelCount; idx++) {
+		files.push({ name: `level ${idx + 1}`, ...readLocation(levelTableOffset + idx * LEVEL_ENTRY_SIZE) });
+	}
+
+	// Files bigger than a page continue on the following ones; those are counted on every page they take
+	const pageCount = Math.ceil(resource.length / PAGE_SIZE);
+	const pages = Array.from({ length: pageCount }, (_, idx) => ({ page: RESOURCE_BANK + idx, used: 0, padding: 0, files: [] }));
+	const problems = [];
+	const formatVersion = resource[3];
+	if (formatVersion !== RESOURCE_FORMAT_VERSION) {
+		problems.push(`the resource has format version ${formatVersion}; the base ROM reads version ${RESOURCE_FORMAT_VERSION}`);
+	}
+	files.forEach(f => {
+		const start = (f.page - RESOURCE_BANK) * PAGE_SIZE + f.offset;
+		const end = start + f.size;
+		if (f.page < RESOURCE_BANK || end > resource.length) {
+			problems.push(`${f.name} (page ${f.page}, offset ${f.offset}, ${f.size} bytes) is outside of the resource`);
+			return;
+		}
+		if (f.size <= PAGE_SIZE && Math.floor(start / PAGE_SIZE) !== Math.floor((end - 1) / PAGE_SIZE)) {
+			problems.push(`${f.name} crosses a page boundary, but fits in a page`);
+		}
+
+		for (let pageIdx = Math.floor(start / PAGE_SIZE); pageIdx * PAGE_SIZE < end; pageIdx++) {
+			const pageStart = pageIdx * PAGE_SIZE;
+			pages[pageIdx].used += Math.min(end, pageStart + PAGE_SIZE) - Math.max(start, pageStart);
+			pages[pageIdx].files.push(f.name);
+		}
+	});
+
+	pages.forEach(p => {
+		p.padding = PAGE_SIZE - p.used;
+		if (p.padding < 0) problems.push(`page ${p.page} has ${p.used} bytes allocated; files are overlapping`);
+	});
+
+	const totalUsed = files.reduce((acc, f) => acc + f.size, 0);
+	return {
+		file,
+		formatVersion,
+		pageCount,
+		totalSize: pageCount * PAGE_SIZE,
+		totalUsed,
+		totalPadding: pageCount * PAGE_SIZE - totalUsed,
+		fileCount,
+		levelCount,
+		files,
+		pages,
+		problems
+	};
+};
+
+/*
+ * Reads the areas and symbols of an sdld map file. Areas look like:
+ *
+ *   _CODE                               00000200    00002C2F =       11311. bytes (REL,CON)
+ *
+ * followed by their symbols, with their address, name and module:
+ *
+ *        00000200  _main                              puzzle_maker_base_rom
+ */
+const parseMap = text => {
+	const areas = [];
+	let area = null;
+
+	text.split(/\r?\n/).forEach(line => {
+		const areaMatch = line.match(/^\.?\s*(\S+)\s+([0-9A-Fa-f]{4,8})\s+([0-9A-Fa-f]{4,8})\s+=\s+(\d+)\.\s+bytes/);
+		if (areaMatch) {
+			area = { name: areaMatch[1], address: parseInt(areaMatch[2], 16), size: parseInt(areaMatch[4], 10), symbols: [] };
+			areas.push(area);
+			return;
+		}
+
+		const symbolMatch = area && line.match(/^\s+(?:[A-Z]:\s+)?([0-9A-Fa-f]{4,8})\s+(\S+)(?:\s+(\S+))?\s*$/);
+		if (symbolMatch) {
+			area.symbols.push({ address: parseInt(symbolMatch[1], 16), name: symbolMatch[2], module: symbolMatch[3] || '' });
+		}
+	});
+
+	return areas;
+};
+
+const classifyArea = area => {
+	if (area.address >= RAM_START) return 'ram';
+	return CONST_AREAS.includes(area.name) ? 'const' : 'code';
+};
+
+const analyzeMap = (file, text) => {
+	const areas = parseMap(text).filter(a => a.size && a.name !== '.ABS.');
+	if (!areas.length) throw new Error(`${file}: no linker areas found`);
+
+	// Symbols take everything up to the next symbol on the same area, so the sizes are approximate
+	const symbols = [];
+	areas.forEach(area => {
+		const sorted = [...area.symbols]
+			.filter(s => s.address >= area.address && s.address < area.address + area.size && !s.name.startsWith('s_') && !s.name.startsWith('l_'))
+			.sort((a, b) => a.address - b.address);
+		sorted.forEach((s, idx) => {
+			const end = idx + 1 < sorted.length ? sorted[idx + 1].address : area.address + area.size;
+			symbols.push({ ...s, area: area.name, kind: classifyArea(area), size: end - s.address });
+		});
+	});
+
+	const totals = { code: 0, const: 0, ram: 0 };
+	areas.forEach(area => totals[classifyArea(area)] += area.size);
+
+	const modules = {};
+	symbols.forEach(({ module, kind, size }) => {
+		const name = module || '(unknown)';
+		modules[name] = modules[name] || { code: 0, const: 0, ram: 0 };
+		modules[name][kind] += size;
+	});
+
+	return {
+		file,
+		rom: { code: totals.code, const: totals.const, limit: BASE_ROM_SIZE, free: BASE_ROM_SIZE - totals.code - totals.const },
+		ram: { used: totals.ram, limit: RAM_SIZE, free: RAM_SIZE - totals.ram },
+		areas: areas.map(({ name, address, size }) => ({ name, address, size, kind: classifyArea({ name, address }) })),
+		modules: Object.entries(modules).map(([name, sizes]) => ({ name, ...sizes })).sort((a, b) => (b.code + b.const + b.ram) - (a.code + a.const + a.ram)),
+		topRamSymbols: symbols.filter(s => s.kind === 'ram').sort((a, b) => b.size - a.size).slice(0, TOP_SYMBOL_COUNT)
+			.map(({ name, module, address, size }) => ({ name, module, address, size }))
+	};
+};
+
+const hex = n => '0x' + n.toString(16).toUpperCase().padStart(4, '0');
+const percent = (n, total) => `${(n * 100 / total).toFixed(1)}%`;
+
+const printResource = r => {
+	console.log(`Resource: ${r.file}`);
+	console.log(`  Format version ${r.formatVersion}; ${r.fileCount} named file(s), ${r.levelCount} level(s), ${r.pageCount} page(s) (${r.totalSize} bytes); ` +
+		`${r.totalUsed} bytes used, ${r.totalPadding} bytes of padding (${percent(r.totalPadding, r.totalSize)})`);
+
+	console.log('\n  File                   Page  Offset    Size');
+	r.files.forEach(f => console.log(`  ${f.name.padEnd(20)} ${f.page.toString().padStart(6)}  ${hex(f.offset)}  ${f.size.toString().padStart(6)}`));
+
+	console.log('\n  Page    Used  Padding  Files');
+	r.pages.forEach(p => console.log(`  ${p.page.toString().padStart(4)}  ${p.used.toString().padStart(6)}  ${p.padding.toString().padStart(7)}  ${p.files.length}`));
+
+	r.problems.forEach(p => console.log(`  PROBLEM: ${p}`));
+};
+
+const printMap = m => {
+	console.log(`Base ROM: ${m.file}`);
+	console.log(`  ROM: ${m.rom.code} bytes of code + ${m.rom.const} bytes of constants = ${m.rom.code + m.rom.const} of ${m.rom.limit} ` +
+		`(${percent(m.rom.code + m.rom.const, m.rom.limit)}); ${m.rom.free} free before the resource pages`);
+	console.log(`  RAM: ${m.ram.used} of ${m.ram.limit} bytes (${percent(m.ram.used, m.ram.limit)}); ${m.ram.free} left for the stack`);
+
+	console.log('\n  Area                  Address    Size  Kind');
+	m.areas.forEach(a => console.log(`  ${a.name.padEnd(20)} ${hex(a.address).padStart(8)}  ${a.size.toString().padStart(6)}  ${a.kind}`));
+
+	console.log('\n  Module                        Code   Const     RAM');
+	m.modules.forEach(mod => console.log(`  ${mod.name.padEnd(26)} ${mod.code.toString().padStart(7)} ${mod.const.toString().padStart(7)} ${mod.ram.toString().padStart(7)}`));
+
+	console.log(`\n  Biggest RAM symbols`);
+	m.topRamSymbols.forEach(s => console.log(`  ${s.name.padEnd(32)} ${hex(s.address)}  ${s.size.toString().padStart(6)}  ${s.module}`));
+};
+
+try {
+	const args = parseArgs(process.argv.slice(2));
+	const report = {};
+
+	if (args.resource) {
+		report.resource = analyzeResource(args.resource, fs.readFileSync(args.resource));
+		printResource(report.resource);
+	}
+	if (args.map) {
+		if (args.resource) console.log('');
+		report.baseRom = analyzeMap(args.map, fs.readFileSync(args.map, 'utf8'));
+		printMap(report.baseRom);
+	}
+
+	if (args.json) fs.writeFileSync(args.json, JSON.stringify(report, null, '\t'));
+
+	// Lets CI fail on a broken pack, or on a base ROM that no longer fits
+	const overflows = report.baseRom && (report.baseRom.rom.free < 0 || report.baseRom.ram.free < 0);
+	if ((report.resource && report.resource.problems.length) || overflows) process.exit(1);
+} catch (e) {
+	console.error(e.message);
+	process.exit(2);
+}
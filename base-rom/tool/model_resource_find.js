@@ -0,0 +1,73 @@
+'use strict';
+
+/*
+ * Cost model, not a measurement: estimates the Z80 cost of looking up resources on a 999-level pack,
+ * comparing the old sequential strcmp() scan with the binary search and the direct level table.
+ *
+ * The number of steps and character comparisons of each lookup are exact, but the T-states per step
+ * in COST are guesses for the code SDCC generates, never checked against it. For measured figures,
+ * build the base ROM with 'make CFLAGS=-DBENCHMARK': the level screen shows the cycles per
+ * resource_find() and per level lookup, timed with the V counter.
+ *
+ * Usage: node tool/model_resource_find.js [level count]
+ */
+
+const LEVEL_COUNT = parseInt(process.argv[2]) || 999;
+const CYCLES_PER_FRAME = 59736; // 3.58 MHz at 59.92 Hz (NTSC)
+
+// Guessed, not measured
+const COST = {
+	strcmpCall: 60,         // argument pushing, call and return
+	strcmpChar: 40,         // one iteration of the strcmp() inner loop
+	scanStep: 50,           // pointer increment and remaining entries check
+	binarySearchStep: 250,  // midpoint, entry address (16-bit multiply) and branch
+	sprintf: 6000,          // sprintf("level%03d.map", n), including the division loop
+	levelTableLookup: 200   // bounds check and entry address (16-bit multiply)
+};
+
+const levelFileName = n => `level${n.toString().padStart(3, '0')}.map`;
+const namedFileNames = ['main.atr', 'main.mtl', 'main.pal', 'main.til', 'merging.dat', 'project.inf'];
+const levelFileNames = Array.from({ length: LEVEL_COUNT }, (_, idx) => levelFileName(idx + 1));
+
+const strcmpCost = (a, b) => {
+	let chars = 1;
+	for (let idx = 0; idx < a.length && a[idx] === b[idx]; idx++) chars++;
+	return COST.strcmpCall + chars * COST.strcmpChar;
+};
+
+const sequentialFind = (entries, name) => {
+	let cycles = 0;
+	for (const entry of entries) {
+		cycles += COST.scanStep + strcmpCost(name, entry);
+		if (entry === name) break;
+	}
+	return cycles;
+};
+
+const binaryFind = (entries, name) => {
+	let cycles = 0;
+	let low = 0, high = entries.length;
+	while (low < high) {
+		const middle = (low + high) >> 1;
+		cycles += COST.binarySearchStep + strcmpCost(name, entries[middle]);
+		if (entries[middle] === name) break;
+		if (name < entries[middle]) high = middle; else low = middle + 1;
+	}
+	return cycles;
+};
+
+const oldEntries = [...namedFileNames, ...levelFileNames].sort();
+
+const report = (label, cyclesList) => {
+	const total = cyclesList.reduce((acc, n) => acc + n, 0);
+	const avg = Math.round(total / cyclesList.length);
+	const max = Math.max(...cyclesList);
+	console.log(`${label.padEnd(36)} avg ~${avg.toString().padStart(8)} T   max ~${max.toString().padStart(8)} T   (${(avg / CYCLES_PER_FRAME * 100).toFixed(1)}% of a frame)`);
+};
+
+console.log(`Modelled resource lookup cost for ${namedFileNames.length} named files + ${LEVEL_COUNT} levels (estimates, see COST)\n`);
+
+report('load_map(n), old: sprintf + scan', levelFileNames.map(name => COST.sprintf + sequentialFind(oldEntries, name)));
+report('load_map(n), new: level table', levelFileNames.map(() => COST.levelTableLookup));
+report('resource_find(name), old: scan', namedFileNames.map(name => sequentialFind(oldEntries, name)));
+report('resource_find(name), new: binary', namedFileNames.map(name => binaryFind(namedFileNames, name)));
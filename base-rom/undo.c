@@ -0,0 +1,120 @@
+#include "undo.h"
+
+#define UNDO_BUFFER_MASK (UNDO_BUFFER_SIZE - 1)
+
+#define UNDO_HEADER(direction, cell_count) ((direction) | ((cell_count) << 2))
+#define UNDO_HEADER_DIRECTION(header) ((header) & 0x03)
+#define UNDO_HEADER_CELL_COUNT(header) (((header) >> 2) & 0x07)
+
+unsigned char undo_buffer[UNDO_BUFFER_SIZE];
+
+/* Free running positions; only masked when accessing the buffer */
+unsigned int undo_start, undo_cursor, undo_end;
+
+undo_move undo_pending, undo_result;
+
+unsigned int undo_record_size(unsigned char header) {
+	unsigned char cell_count = UNDO_HEADER_CELL_COUNT(header);
+	return cell_count ? 2 + cell_count * 3 : 1;
+}
+
+void undo_clear() {
+	undo_start = 0;
+	undo_cursor = 0;
+	undo_end = 0;
+	undo_pending.cell_count = 0;
+}
+
+void undo_begin_move() {
+	undo_pending.cell_count = 0;
+}
+
+void undo_record_cell(unsigned char x, unsigned char y, unsigned char layer, unsigned char diff) {
+	static undo_cell *cell;
+
+	if (!diff || undo_pending.cell_count == UNDO_MAX_CELLS) return;
+
+	cell = undo_pending.cells + undo_pending.cell_count;
+	cell->x = x;
+	cell->y = y | layer;
+	cell->diff = diff;
+	undo_pending.cell_count++;
+}
+
+void undo_put(unsigned char value) {
+	undo_buffer[undo_end & UNDO_BUFFER_MASK] = value;
+	undo_end++;
+}
+
+void undo_commit_move(unsigned char direction) {
+	static unsigned char header, i;
+	static unsigned int size;
+	static undo_cell *cell;
+
+	header = UNDO_HEADER(direction, undo_pending.cell_count);
+	size = undo_record_size(header);
+
+	/* A new move makes the redo history meaningless */
+	undo_end = undo_cursor;
+
+	/* Make room by forgetting the oldest moves */
+	while (UNDO_BUFFER_SIZE - (undo_end - undo_start) < size) {
+		undo_start += undo_record_size(undo_buffer[undo_start & UNDO_BUFFER_MASK]);
+	}
+
+	undo_put(header);
+	if (undo_pending.cell_count) {
+		cell = undo_pending.cells;
+		for (i = undo_pending.cell_count; i; i--) {
+			undo_put(cell->x);
+			undo_put(cell->y);
+			undo_put(cell->diff);
+			cell++;
+		}
+		undo_put(header);
+	}
+
+	undo_cursor = undo_end;
+	undo_pending.cell_count = 0;
+}
+
+/* Reads the record that starts at the given position */
+undo_move *undo_read(unsigned int position) {
+	static unsigned char header, i;
+	static undo_cell *cell;
+
+	header = undo_buffer[position & UNDO_BUFFER_MASK];
+	position++;
+
+	undo_result.direction = UNDO_HEADER_DIRECTION(header);
+	undo_result.cell_count = UNDO_HEADER_CELL_COUNT(header);
+
+	cell = undo_result.cells;
+	for (i = undo_result.cell_count; i; i--) {
+		cell->x = undo_buffer[position & UNDO_BUFFER_MASK];
+		cell->y = undo_buffer[(position + 1) & UNDO_BUFFER_MASK];
+		cell->diff = undo_buffer[(position + 2) & UNDO_BUFFER_MASK];
+		position += 3;
+		cell++;
+	}
+
+	return &undo_result;
+}
+
+undo_move *undo_pop() {
+	if (undo_cursor == undo_start) return 0;
+
+	/* The last byte of a record is always its header */
+	undo_cursor -= undo_record_size(undo_buffer[(undo_cursor - 1) & UNDO_BUFFER_MASK]);
+	return undo_read(undo_cursor);
+}
+
+undo_move *redo_pop() {
+	static unsigned int position;
+
+	if (undo_cursor == undo_end) return 0;
+
+	position = undo_cursor;
+	undo_cursor += undo_record_size(undo_buffer[position & UNDO_BUFFER_MASK]);
+	return undo_read(position);
+}
@@ -0,0 +1,57 @@
+#ifndef UNDO_H
+#define UNDO_H
+
+/*
+ * Undo/redo history, stored as a ring of variable length records.
+ *
+ * A move that doesn't change the map takes a single byte: its header, with the direction the player
+ * moved on bits 0-1 and the number of changed cells on bits 2-4. Otherwise, the header is repeated
+ * after the cells, so that the record can be walked from both ends; each cell takes 3 bytes: x, y
+ * (with UNDO_LAYER_FLOOR on bit 7), and the old value XOR the new one, which works both ways.
+ *
+ * A push changes at most 4 cells: the tile on both map cells, the floor it uncovers and the one it
+ * covers; most pushes only change the 2 map cells. So no record is longer than UNDO_MAX_RECORD_SIZE
+ * (14) bytes; when the buffer is full, the oldest records are dropped. With the default 1024 bytes,
+ * at least the last 73 moves can always be undone, and up to 1024 if the player didn't push anything.
+ */
+
+/* Must be a power of two */
+#ifndef UNDO_BUFFER_SIZE
+#define UNDO_BUFFER_SIZE (1024)
+#endif
+
+#define UNDO_MAX_CELLS (4)
+#define UNDO_MAX_RECORD_SIZE (2 + UNDO_MAX_CELLS * 3)
+#define UNDO_GUARANTEED_DEPTH (UNDO_BUFFER_SIZE / UNDO_MAX_RECORD_SIZE)
+
+#define UNDO_LAYER_MAP (0)
+#define UNDO_LAYER_FLOOR (0x80)
+
+#define UNDO_DIR_UP (0)
+#define UNDO_DIR_DOWN (1)
+#define UNDO_DIR_LEFT (2)
+#define UNDO_DIR_RIGHT (3)
+
+typedef struct undo_cell {
+	unsigned char x;
+	unsigned char y; /* Also has the layer on bit 7 */
+	unsigned char diff;
+} undo_cell;
+
+typedef struct undo_move {
+	unsigned char direction;
+	unsigned char cell_count;
+	undo_cell cells[UNDO_MAX_CELLS];
+} undo_move;
+
+void undo_clear();
+
+void undo_begin_move();
+void undo_record_cell(unsigned char x, unsigned char y, unsigned char layer, unsigned char diff);
+void undo_commit_move(unsigned char direction);
+
+/* Both return 0 if there's nothing to undo/redo */
+undo_move *undo_pop();
+undo_move *redo_pop();
+
+#endif /* UNDO_H */
@@ -0,0 +1,221 @@
+#include "lib/SMSlib.h"
+#include "vram_queue.h"
+
+#define VRAM_QUEUE_MASK (VRAM_QUEUE_SIZE - 1)
+
+_Static_assert(VRAM_QUEUE_DEFAULT_BUDGET >= VRAM_QUEUE_MIN_BUDGET, "The default budget must fit a whole name table column");
+
+/* Name table layout: 32 entries of 2 bytes per row; 28 rows */
+#define NAME_TABLE_ROW_SIZE (32 * 2)
+#define NAME_TABLE_ROWS (28)
+
+vram_command vram_queue[VRAM_QUEUE_SIZE];
+unsigned char vram_queue_head, vram_queue_tail, vram_queue_count;
+/* Commands ever queued, wrapping around; see vram_queue_mark() */
+unsigned char vram_queue_pushed;
+char vram_queue_direct;
+
+unsigned int vram_queue_budget = VRAM_QUEUE_DEFAULT_BUDGET;
+
+unsigned char vram_queue_high_water_mark;
+unsigned int vram_queue_deferred_frames;
+
+void vram_queue_init() {
+	vram_queue_head = 0;
+	vram_queue_tail = 0;
+	vram_queue_count = 0;
+	vram_queue_pushed = 0;
+	vram_queue_direct = 0;
+	
+	vram_queue_high_water_mark = 0;
+	vram_queue_deferred_frames = 0;
+}
+
+void vram_queue_execute(vram_command *cmd) {
+	static unsigned char previous_bank;
+	static unsigned int addr;
+	static unsigned int *src;
+	static unsigned char count;
+
+	switch (cmd->type) {
+		
+	case VRAM_CMD_NAME_TILE:
+		SMS_setAddr(cmd->addr);
+		SMS_setTile(cmd->value);
+		break;
+		
+	case VRAM_CMD_TILES:
+		previous_bank = ROM_bank_to_be_mapped_on_slot2;
+		SMS_mapROMBank(cmd->bank);
+		SMS_VRAMmemcpy(cmd->addr, cmd->src, cmd->value);
+		SMS_mapROMBank(previous_bank);
+		break;
+		
+	case VRAM_CMD_COPY:
+		SMS_VRAMmemcpy(cmd->addr, cmd->src, cmd->value);
+		break;
+		
+	case VRAM_CMD_NAME_COLUMN:
+		addr = cmd->addr;
+		src = cmd->src;
+		for (count = cmd->value; count; count--) {
+			SMS_setAddr(addr);
+			SMS_setTile(*src);
+			src++;
+			
+			/* Next row, wrapping around the bottom of the name table */
+			addr += NAME_TABLE_ROW_SIZE;
+			if (addr >= XYtoADDR(0, NAME_TABLE_ROWS)) addr -= NAME_TABLE_ROWS * NAME_TABLE_ROW_SIZE;
+		}
+		break;
+		
+	case VRAM_CMD_BG_COLOR:
+		SMS_setBGPaletteColor(cmd->addr, cmd->value);
+		break;
+		
+	case VRAM_CMD_SPRITE_COLOR:
+		SMS_setSpritePaletteColor(cmd->addr, cmd->value);
+		break;
+	}
+}
+
+/* Number of bytes the command will write to the VDP */
+unsigned int vram_command_cost(vram_command *cmd) {
+	switch (cmd->type) {
+	case VRAM_CMD_NAME_TILE: return 2;
+	case VRAM_CMD_NAME_COLUMN: return cmd->value << 1;
+	case VRAM_CMD_TILES:
+	case VRAM_CMD_COPY:
+		return cmd->value;
+	}
+	return 1;
+}
+
+vram_command *vram_queue_next_free() {
+	static vram_command *cmd;
+
+	/* Queue full: wait for the next blanking period to make room */
+	if (vram_queue_count == VRAM_QUEUE_SIZE) {
+		SMS_waitForVBlank();
+		vram_queue_drain();
+	}
+
+	cmd = vram_queue + vram_queue_tail;
+	vram_queue_tail = (vram_queue_tail + 1) & VRAM_QUEUE_MASK;
+	vram_queue_count++;
+	vram_queue_pushed++;
+	
+	if (vram_queue_count > vram_queue_high_water_mark) {
+		vram_queue_high_water_mark = vram_queue_count;
+	}
+	
+	return cmd;
+}
+
+void vram_queue_push(unsigned char type, unsigned char bank, unsigned int addr, unsigned int value, void *src) {
+	static vram_command direct_cmd;
+	static vram_command *cmd;
+	
+	cmd = vram_queue_direct ? &direct_cmd : vram_queue_next_free();
+	
+	cmd->type = type;
+	cmd->bank = bank;
+	cmd->addr = addr;
+	cmd->value = value;
+	cmd->src = src;
+	
+	if (vram_queue_direct) vram_queue_execute(cmd);
+}
+
+/* When set, the commands are executed immediately; useful while the display is off */
+void vram_queue_set_direct(char direct) {
+	if (direct) {
+		while (vram_queue_count) vram_queue_drain();
+	}
+	vram_queue_direct = direct;
+}
+
+void vram_queue_name_tile(unsigned char x, unsigned char y, unsigned int tile) {
+	vram_queue_push(VRAM_CMD_NAME_TILE, 0, XYtoADDR(x, y), tile, 0);
+}
+
+void vram_queue_tiles(void *src, unsigned char bank, unsigned int tilefrom, unsigned int size) {
+	vram_queue_push(VRAM_CMD_TILES, bank, TILEtoADDR(tilefrom), size, src);
+}
+
+/* Copies from RAM, so that the source doesn't need bank switching */
+void vram_queue_copy(unsigned int addr, void *src, unsigned int size) {
+	vram_queue_push(VRAM_CMD_COPY, 0, addr, size, src);
+}
+
+/* Writes a column of name table entries, one per row; the column can wrap around the bottom of the name table */
+void vram_queue_name_column(unsigned char x, unsigned char y, unsigned int *src, unsigned char count) {
+	vram_queue_push(VRAM_CMD_NAME_COLUMN, 0, XYtoADDR(x, y), count, src);
+}
+
+void vram_queue_bg_color(unsigned char entry, unsigned char color) {
+	vram_queue_push(VRAM_CMD_BG_COLOR, 0, entry, color, 0);
+}
+
+void vram_queue_sprite_color(unsigned char entry, unsigned char color) {
+	vram_queue_push(VRAM_CMD_SPRITE_COLOR, 0, entry, color, 0);
+}
+
+/* Must be called right after SMS_waitForVBlank(); whatever exceeds the budget is left for the next frame */
+void vram_queue_drain() {
+	static unsigned int remaining_budget, cost;
+	static vram_command *cmd;
+	
+	/* Anything less would leave a column stuck at the head of the queue forever */
+	remaining_budget = vram_queue_budget < VRAM_QUEUE_MIN_BUDGET ? VRAM_QUEUE_MIN_BUDGET : vram_queue_budget;
+	
+	while (vram_queue_count) {
+		cmd = vram_queue + vram_queue_head;
+		cost = vram_command_cost(cmd);
+		
+		if (cost > remaining_budget) {
+			/* Block copies can be split across frames; everything else waits for the next one */
+			if ((cmd->type == VRAM_CMD_TILES || cmd->type == VRAM_CMD_COPY) && remaining_budget) {
+				cmd->value = remaining_budget;
+				vram_queue_execute(cmd);
+				
+				cmd->addr += remaining_budget;
+				cmd->src = (char *) cmd->src + remaining_budget;
+				cmd->value = cost - remaining_budget;
+			}
+			
+			vram_queue_deferred_frames++;
+			return;
+		}
+		
+		vram_queue_execute(cmd);
+		remaining_budget -= cost;
+		
+		vram_queue_head = (vram_queue_head + 1) & VRAM_QUEUE_MASK;
+		vram_queue_count--;
+	}
+}
+
+/* Waits until every queued command has been sent, so that their source buffers can be reused */
+void vram_queue_flush() {
+	while (vram_queue_count) {
+		SMS_waitForVBlank();
+		vram_queue_drain();
+	}
+}
+
+unsigned char vram_queue_mark() {
+	return vram_queue_pushed;
+}
+
+/* The queue is sent in order, so the marked commands are gone once the ones still waiting were all queued after the mark */
+char vram_queue_is_sent(unsigned char mark) {
+	return vram_queue_count <= (unsigned char) (vram_queue_pushed - mark);
+}
+
+void vram_queue_wait_sent(unsigned char mark) {
+	while (!vram_queue_is_sent(mark)) {
+		SMS_waitForVBlank();
+		vram_queue_drain();
+	}
+}
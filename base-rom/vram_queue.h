@@ -0,0 +1,54 @@
+#ifndef VRAM_QUEUE_H
+#define VRAM_QUEUE_H
+
+/* Must be a power of two */
+#define VRAM_QUEUE_SIZE (64)
+#define VRAM_QUEUE_DEFAULT_BUDGET (160)
+
+/* Name table columns can't be split across frames, so the budget must let the tallest one through at once */
+#define VRAM_QUEUE_MAX_COLUMN_ROWS (24)
+#define VRAM_QUEUE_MIN_BUDGET (VRAM_QUEUE_MAX_COLUMN_ROWS * 2)
+
+#define VRAM_CMD_NAME_TILE (1)
+#define VRAM_CMD_TILES (2)
+#define VRAM_CMD_BG_COLOR (3)
+#define VRAM_CMD_SPRITE_COLOR (4)
+#define VRAM_CMD_COPY (5)
+#define VRAM_CMD_NAME_COLUMN (6)
+
+typedef struct vram_command {
+	unsigned char type;
+	unsigned char bank;
+	unsigned int addr;
+	unsigned int value;
+	void *src;
+} vram_command;
+
+/* Maximum number of bytes written to the VDP by each call to vram_queue_drain(); never less than VRAM_QUEUE_MIN_BUDGET */
+extern unsigned int vram_queue_budget;
+
+/* Statistics, for sizing the budget */
+extern unsigned char vram_queue_high_water_mark;
+extern unsigned int vram_queue_deferred_frames;
+
+void vram_queue_init();
+void vram_queue_set_direct(char direct);
+
+void vram_queue_name_tile(unsigned char x, unsigned char y, unsigned int tile);
+void vram_queue_tiles(void *src, unsigned char bank, unsigned int tilefrom, unsigned int size);
+void vram_queue_copy(unsigned int addr, void *src, unsigned int size);
+/* count must be at most VRAM_QUEUE_MAX_COLUMN_ROWS */
+void vram_queue_name_column(unsigned char x, unsigned char y, unsigned int *src, unsigned char count);
+void vram_queue_bg_color(unsigned char entry, unsigned char color);
+void vram_queue_sprite_color(unsigned char entry, unsigned char color);
+
+void vram_queue_drain();
+void vram_queue_flush();
+
+/* Identifies the commands queued so far; vram_queue_is_sent() tells whether all of them have reached the VDP */
+unsigned char vram_queue_mark();
+char vram_queue_is_sent(unsigned char mark);
+/* Waits as many frames as needed for the marked commands to be sent, so that their source buffers can be reused */
+void vram_queue_wait_sent(unsigned char mark);
+
+#endif /* VRAM_QUEUE_H */
@@ -1,208 +1,768 @@
 'use strict';
 
 (() => {
-	
-	function padArrayEnd(arr, len, padding){
-	   return arr.concat(Array(len - arr.length).fill(padding));
+
+	/**
+	 * Writes little endian values to a preallocated byte array, at an advancing position.
+	 */
+	class ByteWriter {
+		constructor(bytes, position = 0) {
+			this.bytes = bytes;
+			this.view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+			this.position = position;
+		}
+
+		u8(n) {
+			this.bytes[this.position++] = n;
+			return this;
+		}
+
+		u16(n) {
+			this.view.setUint16(this.position, n & 0xFFFF, true);
+			this.position += 2;
+			return this;
+		}
+
+		copy(bytes) {
+			this.bytes.set(bytes, this.position);
+			this.position += bytes.length;
+			return this;
+		}
+
+		// Zero padded up to length; without a length, zero terminated
+		string(s, length = s.length + 1) {
+			const charCount = Math.min(s.length, length);
+			for (let idx = 0; idx < charCount; idx++) this.bytes[this.position + idx] = s.charCodeAt(idx);
+			this.bytes.fill(0, this.position + charCount, this.position + length);
+			this.position += length;
+			return this;
+		}
 	}
-	
-	const stringToByteArray = s => [...s.split('').map(ch => ch.charCodeAt(0)), 0];
-	const stringToPaddedByteArray = (s, len) => padArrayEnd(s.split('').map(ch => ch.charCodeAt(0)), len, 0);
-	const toBytePair = n => [n & 0xFF, (n >> 8) & 0xFF];
+
+	const levelFileName = n => `level${n.toString().padStart(3, '0')}.map`;
+	const projectInfoStrings = project => [project.tool.name, project.tool.version, project.projectInfo.name];
+
+	/**
+	 * Flattens a map row by row, at the project's map size: the ROM reads every level with that size, so maps saved
+	 * with another one are cropped, or padded with empty cells.
+	 */
+	const flattenTileIndexes = (tileIndexes, width, height) => {
+		const tiles = new Uint8Array(width * height);
+		tileIndexes.slice(0, height).forEach((row, rowNumber) => {
+			tiles.set(row.slice(0, width).map(tile => tile || 0), rowNumber * width);
+		});
+		return tiles;
+	};
+
+	/**
+	 * Simple RLE: a control byte below 0x80 is followed by (control + 1) literal bytes;
+	 * from 0x80 up, the next byte is repeated ((control & 0x7F) + 2) times.
+	 * Without an output, only counts the bytes, so that space can be allocated for them first.
+	 */
+	const rleCompress = (data, output = null, offset = 0) => {
+		const MAX_LITERALS = 128;
+		const MAX_RUN = 129;
+
+		let position = offset;
+		let literalStart = 0;
+		let literalCount = 0;
+		const flushLiterals = () => {
+			if (!literalCount) return;
+			if (output) {
+				output[position] = literalCount - 1;
+				output.set(data.subarray(literalStart, literalStart + literalCount), position + 1);
+			}
+			position += literalCount + 1;
+			literalCount = 0;
+		};
+
+		for (let idx = 0; idx < data.length; ) {
+			let runLength = 1;
+			while (idx + runLength < data.length && data[idx + runLength] === data[idx] && runLength < MAX_RUN) runLength++;
+
+			if (runLength > 1) {
+				flushLiterals();
+				if (output) {
+					output[position] = 0x80 | (runLength - 2);
+					output[position + 1] = data[idx];
+				}
+				position += 2;
+			} else {
+				if (!literalCount) literalStart = idx;
+				literalCount++;
+				if (literalCount === MAX_LITERALS) flushLiterals();
+			}
+
+			idx += runLength;
+		}
+		flushLiterals();
+
+		return position - offset;
+	};
+
+	const TILE_SIZE = 32;
+
+	/**
+	 * Phantasy Star Gaiden tile compression, as understood by SMS_loadPSGaidencompressedTiles().
+	 * Each tile takes a method byte, with two bits per bitplane (bitplane 0 on the highest bits),
+	 * followed by the data for the bitplanes stored raw.
+	 * Only the "all 0x00", "all 0xFF" and "raw" methods are generated.
+	 * The tiles are in the VDP's format: 4 bitplane bytes per line.
+	 */
+	const psgaidenCompress = tileSet => {
+		const METHOD_ZEROES = 0;
+		const METHOD_ONES = 1;
+		const METHOD_RAW = 2;
+
+		const tileCount = tileSet.length / TILE_SIZE;
+		const output = new Uint8Array(2 + tileCount * (1 + TILE_SIZE));
+		const writer = new ByteWriter(output).u16(tileCount);
+
+		for (let tileOffset = 0; tileOffset < tileSet.length; tileOffset += TILE_SIZE) {
+			const methodPosition = writer.position++;
+			let methods = 0;
+
+			for (let planeIdx = 0; planeIdx < 4; planeIdx++) {
+				let allZeroes = true;
+				let allOnes = true;
+				for (let line = 0; line < 8; line++) {
+					const b = tileSet[tileOffset + line * 4 + planeIdx];
+					allZeroes = allZeroes && b === 0x00;
+					allOnes = allOnes && b === 0xFF;
+				}
+
+				let method = METHOD_RAW;
+				if (allZeroes) {
+					method = METHOD_ZEROES;
+				} else if (allOnes) {
+					method = METHOD_ONES;
+				} else {
+					for (let line = 0; line < 8; line++) writer.u8(tileSet[tileOffset + line * 4 + planeIdx]);
+				}
+
+				methods |= method << (6 - planeIdx * 2);
+			}
+
+			output[methodPosition] = methods;
+		}
+
+		return output.subarray(0, writer.position);
+	};
+
+	// VRAM tiles 0 to 3 belong to metatile 0, which is always blank; the font starts at tile 352
+	const FIRST_TILESET_TILE = 4;
+	const MAX_TILESET_TILES = 352 - FIRST_TILESET_TILE;
+
+	// Sprites use the tiles of the first metatiles directly (the player starts at tile 8), and can't be flipped,
+	// so these keep their own 4 tiles, in the same place as before
+	const FIXED_METATILES = 5;
+
+	// Same as MAX_TILE_TYPES on the base ROM; maps can't refer to any metatile past that
+	const MAX_METATILES = 256;
+
+	// Name table entry flags, same as SMSlib's TILE_FLIPPED_X and TILE_FLIPPED_Y
+	const TILE_FLIPPED_X = 0x0200;
+	const TILE_FLIPPED_Y = 0x0400;
+
+	const REVERSED_BITS = Uint8Array.from({ length: 256 }, (_, b) => {
+		let reversed = 0;
+		for (let bit = 0; bit < 8; bit++) {
+			if (b & (1 << bit)) reversed |= 0x80 >> bit;
+		}
+		return reversed;
+	});
+
+	const flipTile = (tile, flags) => {
+		const flipped = new Uint8Array(TILE_SIZE);
+		for (let line = 0; line < 8; line++) {
+			const sourceOffset = (flags & TILE_FLIPPED_Y ? 7 - line : line) * 4;
+			for (let planeIdx = 0; planeIdx < 4; planeIdx++) {
+				const b = tile[sourceOffset + planeIdx];
+				flipped[line * 4 + planeIdx] = flags & TILE_FLIPPED_X ? REVERSED_BITS[b] : b;
+			}
+		}
+		return flipped;
+	};
+
+	/**
+	 * Stores each distinct 8x8 pattern only once, counting its flipped copies as the same pattern.
+	 * The raw tileset has 4 tiles per metatile, starting at metatile 1; each metatile is then described
+	 * by the name table entries of those 4 tiles, in the same order, with metatile 0 all blank.
+	 * Blank quarters use tile 0; patterns that don't fit in VRAM are also left blank.
+	 */
+	const deduplicateTiles = rawTileSet => {
+		const rawTileCount = Math.min(rawTileSet.length / TILE_SIZE, (MAX_METATILES - 1) * 4);
+		const nameEntries = new Uint16Array(FIRST_TILESET_TILE + rawTileCount);
+		const patterns = [];
+		const tileNumbers = new Map();
+		const keyOf = tile => String.fromCharCode(...tile);
+		let missingCount = 0;
+
+		const addPattern = tile => {
+			const tileNumber = FIRST_TILESET_TILE + patterns.length;
+			const key = keyOf(tile);
+			patterns.push(tile);
+			if (!tileNumbers.has(key)) tileNumbers.set(key, tileNumber);
+			return tileNumber;
+		};
+
+		const findPattern = tile => {
+			for (const flags of [0, TILE_FLIPPED_X, TILE_FLIPPED_Y, TILE_FLIPPED_X | TILE_FLIPPED_Y]) {
+				const tileNumber = tileNumbers.get(keyOf(flags ? flipTile(tile, flags) : tile));
+				if (tileNumber !== undefined) return tileNumber | flags;
+			}
+			return -1;
+		};
+
+		for (let rawIdx = 0; rawIdx < rawTileCount; rawIdx++) {
+			const tile = rawTileSet.subarray(rawIdx * TILE_SIZE, (rawIdx + 1) * TILE_SIZE);
+			const entryIdx = FIRST_TILESET_TILE + rawIdx;
+
+			if (rawIdx < FIXED_METATILES * 4) {
+				nameEntries[entryIdx] = addPattern(tile);
+				continue;
+			}
+			if (tile.every(b => !b)) continue;
+
+			let entry = findPattern(tile);
+			if (entry < 0) {
+				if (patterns.length < MAX_TILESET_TILES) {
+					entry = addPattern(tile);
+				} else {
+					missingCount++;
+					entry = 0;
+				}
+			}
+			nameEntries[entryIdx] = entry;
+		}
+
+		if (missingCount) {
+			console.warn(`The tileset has more than ${MAX_TILESET_TILES} distinct 8x8 tiles; ${missingCount} of them will be blank.`);
+		}
+
+		const tileSet = new Uint8Array(patterns.length * TILE_SIZE);
+		patterns.forEach((tile, idx) => tileSet.set(tile, idx * TILE_SIZE));
+
+		// Metatile count, then 4 entries for each metatile
+		const metatileCount = nameEntries.length / 4;
+		const metatiles = new Uint8Array(2 + nameEntries.length * 2);
+		const writer = new ByteWriter(metatiles).u16(metatileCount);
+		nameEntries.forEach(entry => writer.u16(entry));
+
+		return { tileSet, metatiles };
+	};
+
+	const PAGE_SIZE = 16 * 1024;
+
+	// Same as RESOURCE_FORMAT_VERSION on the base ROM; it goes on the last byte of the signature,
+	// and has to change whenever the ROM can no longer read the resources from the previous version
+	const RESOURCE_FORMAT_VERSION = 1;
+
+	// The base ROM carries this, so that a resource is never appended to a ROM that can't read it
+	const BASE_ROM_FORMAT_TAG_PREFIX = 'SMS-Puzzle-Maker rsc v';
+
+	// Base ROMs from before the format was versioned carry no tag; base-rom/dist has one of those until it's rebuilt.
+	// They read a directory of sorted names, then the levels and the tileset uncompressed, and a dense combination table.
+	const LEGACY_FORMAT_VERSION = 0;
+	// Same as the size of map_data on those ROMs
+	const LEGACY_MAX_MAP_CELLS = 9 * 16;
+
+	// Same as MAP_MAX_W, MAP_MAX_H and MAP_MAX_CELLS on the base ROM
+	const MAX_MAP_SIZE = 64;
+	const MAX_MAP_CELLS = 2048;
+	// Same as MAX_TILE_COMBINATIONS on the base ROM
+	const MAX_TILE_COMBINATIONS = 255;
+	// The base ROM keeps the tiles under the pushable ones on a table of MAX_FLOOR_CELLS slots, one of them always empty
+	const MAX_PUSHABLE_TILES = 127;
+	const INITIAL_PAGE = 2;
+
+	// id, width and height, then the name
+	const MAP_HEADER_SIZE = 2 + 2 + 2 + 32;
+
+	// These are used during gameplay, so they're kept on the same page as the directory, if possible
+	const HOT_FILE_NAMES = ['main.atr', 'merging.dat', 'main.pal', 'project.inf'];
+
+	/**
+	 * Packs the files into pages, trying to use as few pages as possible; the directory is on the start of the first one.
+	 * Files bigger than a page take a run of consecutive pages, starting at offset 0; only those are allowed to cross a page boundary.
+	 */
+	const allocatePages = (files, directorySize) => {
+		const pageUsage = [directorySize];
+		const locations = {};
+
+		const placeOnPage = ({ fileName, size }, pageIndex) => {
+			locations[fileName] = { pageNumber: INITIAL_PAGE + pageIndex, offset: pageUsage[pageIndex] };
+			pageUsage[pageIndex] += size;
+		};
+
+		const placeOnFirstFit = file => {
+			let pageIndex = pageUsage.findIndex(used => used + file.size <= PAGE_SIZE);
+			if (pageIndex < 0) {
+				pageIndex = pageUsage.length;
+				pageUsage.push(0);
+			}
+			placeOnPage(file, pageIndex);
+		};
+
+		const bigFiles = files.filter(({ size }) => size > PAGE_SIZE);
+		bigFiles.forEach(({ fileName, size }) => {
+			if (size > 0xFFFF) {
+				throw new Error(`File ${fileName} has ${size} bytes; the maximum is ${0xFFFF}.`);
+			}
+
+			const pageCount = Math.ceil(size / PAGE_SIZE);
+			locations[fileName] = { pageNumber: INITIAL_PAGE + pageUsage.length, offset: 0 };
+			for (let idx = 1; idx < pageCount; idx++) pageUsage.push(PAGE_SIZE);
+			pageUsage.push(size - (pageCount - 1) * PAGE_SIZE);
+		});
+
+		const smallFiles = files.filter(({ size }) => size <= PAGE_SIZE);
+		const hotFiles = smallFiles.filter(({ fileName }) => HOT_FILE_NAMES.includes(fileName));
+		const otherFiles = smallFiles.filter(({ fileName }) => !HOT_FILE_NAMES.includes(fileName));
+
+		// First fit decreasing; the sort is stable, so files of the same size keep their order
+		hotFiles.forEach(placeOnFirstFit);
+		[...otherFiles].sort((a, b) => b.size - a.size).forEach(placeOnFirstFit);
+
+		return { locations, pageCount: pageUsage.length, pageUsage };
+	};
+
+	// A file that's already encoded
+	const contentFile = (fileName, content) => ({
+		fileName,
+		size: content.length,
+		writeTo: (bytes, offset) => bytes.set(content, offset)
+	});
+
+	/**
+	 * Builds the resource image: the directory, then the files, each one written straight to its place.
+	 * Each file has a fileName, a size, and a writeTo(bytes, offset) function.
+	 */
+	const packFiles = files => {
+		// PSGlib can't follow a song or effect across a page boundary, so the base ROM ignores any that doesn't fit in one
+		const bigSong = files.find(({ fileName, size }) => fileName.endsWith('.psg') && size > PAGE_SIZE);
+		if (bigSong) {
+			throw new Error(`File ${bigSong.fileName} has ${bigSong.size} bytes; songs and sound effects can have up to ${PAGE_SIZE} bytes.`);
+		}
+
+		const filesByName = new Map(files.map(file => [file.fileName, file]));
+
+		// Levels are looked up by number on a separate table, so their names don't need to be stored
+		const levelFiles = [];
+		for (let levelNumber = 1; filesByName.has(levelFileName(levelNumber)); levelNumber++) {
+			levelFiles.push(filesByName.get(levelFileName(levelNumber)));
+		}
+		const levelFileSet = new Set(levelFiles);
+
+		// The named entries must be kept sorted, as the ROM uses a binary search on them
+		const namedFiles = files.filter(file => !levelFileSet.has(file)).sort((a, b) => a.fileName < b.fileName ? -1 : a.fileName > b.fileName ? 1 : 0);
+
+		const FILE_NAME_SIZE = 14;
+		const LOCATION_SIZE = 2 + 2 + 2;
+		const HEADER_SIZE = 4 + 2 + 2;
+
+		const fileContentInitialOffset = HEADER_SIZE + namedFiles.length * (FILE_NAME_SIZE + LOCATION_SIZE) + levelFiles.length * LOCATION_SIZE;
+		if (fileContentInitialOffset > PAGE_SIZE) {
+			throw new Error(`The resource directory takes ${fileContentInitialOffset} bytes; it must fit in a single ${PAGE_SIZE} byte page.`);
+		}
+
+		const fileEntries = [...namedFiles, ...levelFiles];
+		const { locations, pageCount, pageUsage } = allocatePages(fileEntries, fileContentInitialOffset);
+
+		// For a detailed report, including the base ROM, see base-rom/tool/footprint_report.js
+		const totalPadding = pageCount * PAGE_SIZE - pageUsage.reduce((acc, used) => acc + used, 0);
+		console.groupCollapsed(`Resource: ${pageCount} page(s), ${totalPadding} bytes of padding`);
+		console.table(pageUsage.map((used, idx) => ({ page: INITIAL_PAGE + idx, used, padding: PAGE_SIZE - used })));
+		console.groupEnd();
+
+		const output = new Uint8Array(pageCount * PAGE_SIZE);
+		const directory = new ByteWriter(output)
+			.string('rsc', 3)
+			.u8(RESOURCE_FORMAT_VERSION)
+			.u16(namedFiles.length)
+			.u16(levelFiles.length);
+
+		const writeLocation = ({ fileName, size }) => {
+			const { pageNumber, offset } = locations[fileName];
+			directory.u16(pageNumber).u16(size).u16(offset);
+		};
+		namedFiles.forEach(file => {
+			directory.string(file.fileName, FILE_NAME_SIZE);
+			writeLocation(file);
+		});
+		levelFiles.forEach(writeLocation);
+
+		fileEntries.forEach(file => {
+			const { pageNumber, offset } = locations[file.fileName];
+			file.writeTo(output, (pageNumber - INITIAL_PAGE) * PAGE_SIZE + offset);
+		});
+
+		return output;
+	};
+
+	/**
+	 * Builds the resource image for a base ROM of LEGACY_FORMAT_VERSION: a header with the file count, the sorted
+	 * directory, then the files. Those ROMs map a single page per file, so none can cross a page boundary.
+	 */
+	const packLegacyFiles = files => {
+		const FILE_ENTRY_SIZE = 14 + 2 + 2 + 2;
+		const HEADER_SIZE = 4 + 2;
+
+		const bigFile = files.find(({ size }) => size > PAGE_SIZE);
+		if (bigFile) {
+			throw new Error(`File ${bigFile.fileName} has ${bigFile.size} bytes; the base ROM can't read files bigger than ` +
+				`${PAGE_SIZE} bytes, it has to be rebuilt from the sources on base-rom.`);
+		}
+
+		const sortedFiles = [...files].sort((a, b) => a.fileName < b.fileName ? -1 : a.fileName > b.fileName ? 1 : 0);
+		const directorySize = HEADER_SIZE + sortedFiles.length * FILE_ENTRY_SIZE;
+		if (directorySize > PAGE_SIZE) {
+			throw new Error(`The resource directory takes ${directorySize} bytes; it must fit in a single ${PAGE_SIZE} byte page.`);
+		}
+
+		const { locations, pageCount } = allocatePages(sortedFiles, directorySize);
+
+		const output = new Uint8Array(pageCount * PAGE_SIZE);
+		const directory = new ByteWriter(output)
+			.string('rsc', 4)
+			.u16(sortedFiles.length);
+		sortedFiles.forEach(file => {
+			const { pageNumber, offset } = locations[file.fileName];
+			directory.string(file.fileName, 14).u16(pageNumber).u16(file.size).u16(offset);
+			file.writeTo(output, (pageNumber - INITIAL_PAGE) * PAGE_SIZE + offset);
+		});
+
+		return output;
+	};
+
+	// Rough decoding costs, in CPU cycles, for the build report
+	const TILE_UPLOAD_CYCLES = {
+		raw: 32 * 22,
+		psgaiden: 32 * 22 + 4 * 80
+	};
+	const CYCLES_PER_FRAME = 59736;
 
 	const that = {
-		
+
+		levelFileName,
+
+		psgaidenCompress,
+
+		/**
+		 * Prepares a single level file: its size is known right away, but it's only encoded when writeTo() is called,
+		 * directly on its final place. It only depends on the map and on the map size.
+		 */
+		prepareMapFile: ({ mapWidth, mapHeight }, { id, name, tileIndexes }) => {
+			const tiles = flattenTileIndexes(tileIndexes, mapWidth, mapHeight);
+			const compressedTileSize = rleCompress(tiles);
+
+			return {
+				rawTileSize: tiles.length,
+				compressedTileSize,
+				size: MAP_HEADER_SIZE + compressedTileSize,
+				writeTo: (bytes, offset) => {
+					const writer = new ByteWriter(bytes, offset)
+						.u16(id)
+						.u16(mapWidth)
+						.u16(mapHeight)
+						.string(name, 32);
+					rleCompress(tiles, bytes, writer.position);
+				}
+			};
+		},
+
+		/**
+		 * Throws if the base ROM couldn't play some of the levels as they are.
+		 */
+		checkMaps: (project) => {
+			const { mapWidth, mapHeight } = project.options;
+			if (mapWidth > MAX_MAP_SIZE || mapHeight > MAX_MAP_SIZE) {
+				throw new Error(`Maps are ${mapWidth}x${mapHeight} tiles; the maximum is ${MAX_MAP_SIZE}x${MAX_MAP_SIZE}.`);
+			}
+			if (mapWidth * mapHeight > MAX_MAP_CELLS) {
+				throw new Error(`Maps are ${mapWidth}x${mapHeight} tiles; they can have up to ${MAX_MAP_CELLS} tiles, e.g. 64x32 or 45x45.`);
+			}
+
+			// Map tile N has the attributes of entry N - 1; empty cells behave as tile 1
+			const attributes = project.tileSet.attributes;
+			const isPushable = tile => !!(attributes[Math.max(tile, 1) - 1] || {}).isPushable;
+			project.maps.forEach(({ name, tileIndexes }) => {
+				const pushableCount = flattenTileIndexes(tileIndexes, mapWidth, mapHeight).filter(isPushable).length;
+				if (pushableCount > MAX_PUSHABLE_TILES) {
+					throw new Error(`The map "${name}" has ${pushableCount} pushable tiles; the maximum is ${MAX_PUSHABLE_TILES}.`);
+				}
+			});
+		},
+
+		/**
+		 * Encodes a single level file on its own, e.g. on a worker.
+		 */
+		generateMapFile: (options, map) => {
+			const { rawTileSize, compressedTileSize, size, writeTo } = that.prepareMapFile(options, map);
+			const content = new Uint8Array(size);
+			writeTo(content, 0);
+
+			return { rawTileSize, compressedTileSize, content };
+		},
+
 		generateObj: (project) => {
 			const to2bpp = c => c >> 6;
-			
+
 			const smsTileSet = project.tileSet.forMasterSystem;
-			
-			const palette = smsTileSet.palettes[0]
-				.map(channels => channels.map(to2bpp))
-				.map(([r, g, b]) => r | g << 2 | b << 4);
-				
-			const processTileLine = line => line.reduce((bitPlanes, pixel, colNum) => {
-				const colMask = 0x80 >> colNum;
-				return bitPlanes.map((plane, planeIdx) => {
-					const planeMask = 0x01 << planeIdx;
-					const finalMask = pixel & planeMask ? colMask : 0;
-					return plane | finalMask;
-				});
-			}, [0, 0, 0, 0]);
-				
-			const processTile = tile => tile.map(processTileLine);
-			const processTileAt = (col, row) => {
-				if (col >= smsTileSet.mapW || row >= smsTileSet.mapH) {
-					return 0;
-				}
-				
-				const tileIndex = (row * smsTileSet.mapW + col) || 0;
-				return processTile(smsTileSet.tiles[tileIndex].pixels);
-			};
-			
+
+			const palette = Uint8Array.from(smsTileSet.palettes[0], channels => {
+				const [r, g, b] = channels.map(to2bpp);
+				return r | g << 2 | b << 4;
+			});
+
 			const tileSetW = Math.ceil(smsTileSet.mapW / 2);
 			const tileSetH = Math.ceil(smsTileSet.mapH / 2);
 			const tileSetSize = tileSetW * tileSetH;
-			
-			const tileSet = [];
+
+			// Each metatile takes 4 tiles, going down each column, then across
+			const rawTileSet = new Uint8Array(tileSetSize * 4 * TILE_SIZE);
+			const writeTileAt = (col, row, tileOffset) => {
+				// Tiles outside of the source image are left blank
+				if (col >= smsTileSet.mapW || row >= smsTileSet.mapH) return;
+
+				const tileIndex = (row * smsTileSet.mapW + col) || 0;
+				smsTileSet.tiles[tileIndex].pixels.forEach((line, lineNum) => {
+					const lineOffset = tileOffset + lineNum * 4;
+					line.forEach((pixel, colNum) => {
+						const colMask = 0x80 >> colNum;
+						for (let planeIdx = 0; planeIdx < 4; planeIdx++) {
+							if (pixel & (0x01 << planeIdx)) rawTileSet[lineOffset + planeIdx] |= colMask;
+						}
+					});
+				});
+			};
+
+			let tileOffset = 0;
 			for (let tileSetRow = 0; tileSetRow < tileSetH; tileSetRow++) {
 				for (let tileSetCol = 0; tileSetCol < tileSetW; tileSetCol++) {
 					const tileRow = tileSetRow * 2;
 					const tileCol = tileSetCol * 2;
-					
-					tileSet.push(processTileAt(tileCol, tileRow));
-					tileSet.push(processTileAt(tileCol, tileRow + 1));
-					tileSet.push(processTileAt(tileCol + 1, tileRow));
-					tileSet.push(processTileAt(tileCol + 1, tileRow + 1));
+
+					writeTileAt(tileCol, tileRow, tileOffset);
+					writeTileAt(tileCol, tileRow + 1, tileOffset + TILE_SIZE);
+					writeTileAt(tileCol + 1, tileRow, tileOffset + TILE_SIZE * 2);
+					writeTileAt(tileCol + 1, tileRow + 1, tileOffset + TILE_SIZE * 3);
+					tileOffset += TILE_SIZE * 4;
 				}
 			}
-			
-			const maps = project.maps.map(({ id, name, tileIndexes }, idx) => ({
-				fileName: `level${(idx + 1).toString().padStart(3, '0')}.map`,
-				content: [
-					...toBytePair(id),
-					...toBytePair(project.options.mapWidth),
-					...toBytePair(project.options.mapHeight),
-					...stringToPaddedByteArray(name, 32, 0),
-					..._.flatten(tileIndexes)
-				]
+
+			const { tileSet, metatiles } = deduplicateTiles(rawTileSet);
+			console.info(`Tile deduplication: ${rawTileSet.length / TILE_SIZE} => ${tileSet.length / TILE_SIZE} tiles`);
+
+			that.checkMaps(project);
+
+			const maps = project.maps.map((map, idx) => ({
+				fileName: levelFileName(idx + 1),
+				...that.prepareMapFile(project.options, map)
 			}));
-			
-			const tileAttributes = project.tileSet.attributes
-				.map(attr => {
-					return ['isSolid', 'isPlayerStart', 'isPlayerEnd', 'isPushable']
-						.reduce((acc, key, idx) => acc | ((attr[key] ? 1 : 0) << idx), 0);
+
+			const totalRawTileSize = maps.reduce((acc, m) => acc + m.rawTileSize, 0);
+			const totalCompressedTileSize = maps.reduce((acc, m) => acc + m.compressedTileSize, 0);
+			console.groupCollapsed(`Map compression: ${totalRawTileSize} => ${totalCompressedTileSize} bytes ` +
+				`(${(totalCompressedTileSize * 100 / (totalRawTileSize || 1)).toFixed(1)}%)`);
+			console.table(maps.map(({ fileName, rawTileSize, compressedTileSize }) => ({
+				fileName, rawTileSize, compressedTileSize,
+				ratio: (compressedTileSize / rawTileSize).toFixed(3)
+			})));
+			console.groupEnd();
+
+			const tileAttributes = new Uint8Array(project.tileSet.attributes.length * 2);
+			const tileAttributeWriter = new ByteWriter(tileAttributes);
+			project.tileSet.attributes.forEach(attr => {
+				tileAttributeWriter.u16(['isSolid', 'isPlayerStart', 'isPlayerEnd', 'isPushable']
+					.reduce((acc, key, idx) => acc | ((attr[key] ? 1 : 0) << idx), 0));
+			});
+
+			// Sparse format: the combinations are grouped by source tile and sorted by dest tile,
+			// with an index telling where each source tile's group starts.
+			const combinationsBySource = Array.from({ length: tileSetSize }, () => []);
+			project.tileSet.combinations
+				.filter(({ sourceTile, destTile, resultTile }) => resultTile && sourceTile <= tileSetSize && destTile <= tileSetSize)
+				.forEach(({ sourceTile, destTile, resultTile }) => {
+					combinationsBySource[sourceTile - 1].push({ destTile, resultTile });
 				});
-				
-			const combinations = Array(tileSetSize).fill(0).map(() => Array(tileSetSize).fill(0));
-			project.tileSet.combinations.forEach(({ sourceTile, destTile, resultTile }) => {
-				combinations[sourceTile - 1][destTile - 1] = resultTile;
+			combinationsBySource.forEach(row => row.sort((a, b) => a.destTile - b.destTile));
+			const combinationCount = combinationsBySource.reduce((acc, row) => acc + row.length, 0);
+			if (combinationCount > MAX_TILE_COMBINATIONS) {
+				throw new Error(`The tileset has ${combinationCount} tile combinations; the maximum is ${MAX_TILE_COMBINATIONS}.`);
+			}
+
+			const combinations = new Uint8Array(2 + 2 + (tileSetSize + 1) * 2 + combinationCount * 2);
+			const combinationWriter = new ByteWriter(combinations)
+				.u16(tileSetSize)
+				.u16(combinationCount);
+			let combinationRowStart = 0;
+			combinationWriter.u16(combinationRowStart);
+			combinationsBySource.forEach(row => {
+				combinationRowStart += row.length;
+				combinationWriter.u16(combinationRowStart);
 			});
-				
-			const projectInfo = [project.tool.name, project.tool.version, project.projectInfo.name].map(stringToByteArray);
-				
+			combinationsBySource.forEach(row => row.forEach(({ destTile }) => combinationWriter.u8(destTile)));
+			combinationsBySource.forEach(row => row.forEach(({ resultTile }) => combinationWriter.u8(resultTile)));
+
+			const infoStrings = projectInfoStrings(project);
+			const projectInfo = new Uint8Array(infoStrings.reduce((acc, s) => acc + s.length + 1, 0));
+			const projectInfoWriter = new ByteWriter(projectInfo);
+			infoStrings.forEach(s => projectInfoWriter.string(s));
+
+			let compressedTileSet = project.projectInfo.compressTileSet ? psgaidenCompress(tileSet) : null;
+			if (compressedTileSet) {
+				const tileCount = tileSet.length / TILE_SIZE;
+				const framesFor = cycles => (cycles * tileCount / CYCLES_PER_FRAME).toFixed(2);
+				console.info(`Tileset compression: ${tileSet.length} => ${compressedTileSet.length} bytes, ` +
+					`saving ${tileSet.length - compressedTileSet.length} bytes of ROM; ` +
+					`estimated upload time goes from ${framesFor(TILE_UPLOAD_CYCLES.raw)} to ${framesFor(TILE_UPLOAD_CYCLES.psgaiden)} frames.`);
+
+				if (compressedTileSet.length >= tileSet.length) {
+					console.info('Compression did not help; the tileset will be stored uncompressed.');
+					compressedTileSet = null;
+				}
+			}
+
 			return {
 				palette,
-				tileSet: _.flatten(tileSet),
-				tileAttributes: _.flatten(tileAttributes.map(toBytePair)),
-				projectInfo: _.flatten(projectInfo),
-				combinations: _.flatten([toBytePair(tileSetSize), combinations]),
+				tileSetSize,
+				rawTileSet,
+				tileSet,
+				compressedTileSet,
+				metatiles,
+				tileAttributes,
+				projectInfo,
+				combinations,
 				maps
 			};
 		},
-		
-		generateInternalFiles: (project) => {
-			const obj = that.generateObj(project);
 
-			const maps = Object.fromEntries(obj.maps.map(m => [m.fileName, m.content]));
+		// Everything but the levels
+		generateTileSetFiles: (obj) => {
+			const paddedPalette = new Uint8Array(Math.max(16, obj.palette.length));
+			paddedPalette.set(obj.palette);
 
 			return {
-				'main.pal': padArrayEnd(obj.palette, 16, 0),
-				'main.til': obj.tileSet,
+				'main.pal': paddedPalette,
+				// main.pga holds the tileset in PSGaiden format; main.til, uncompressed
+				...(obj.compressedTileSet ? { 'main.pga': obj.compressedTileSet } : { 'main.til': obj.tileSet }),
+				// main.mtl has the name table entries for the 4 tiles of each metatile
+				'main.mtl': obj.metatiles,
 				'main.atr': obj.tileAttributes,
 				'project.inf': obj.projectInfo,
-				'merging.dat': obj.combinations,
+				'merging.dat': obj.combinations
+			};
+		},
+
+		generateInternalFiles: (project) => {
+			const obj = that.generateObj(project);
+
+			const maps = Object.fromEntries(obj.maps.map(m => {
+				const content = new Uint8Array(m.size);
+				m.writeTo(content, 0);
+				return [m.fileName, content];
+			}));
+
+			return {
+				...that.generateTileSetFiles(obj),
 				...maps
-			};			
+			};
 		},
-		
+
+		// The levels are encoded directly on the image, without an intermediate copy
 		generateInternalFileSystem: (project) => {
-			const internalFiles = that.generateInternalFiles(project);
-			const fileEntries = Object.keys(internalFiles).sort()
-				.map(fileName => ({ fileName, content: internalFiles[fileName] }));
-				
-			const fileEntryFormat = {
-				name: 14,
-				page: 2,
-				size: 2,
-				offset: 2
-			};
-			
-			const fileEntrySize = Object.values(fileEntryFormat).reduce((acc, n) => acc + n, 0);
-			const fileEntriesSize = fileEntries.length * fileEntrySize;
-			
-			const header = [
-				...stringToPaddedByteArray('rsc', 4),
-				...toBytePair(fileEntries.length)
-			];
-
-			const fileContentInitialOffset = header.length + fileEntriesSize;
-			
-			const PAGE_SIZE = 16 * 1024;
-			const INITIAL_PAGE = 2;
-			
-			// For now, uses a simplistic page allocation
-			let nextPageNumber = INITIAL_PAGE;
-			let fileContentOffset = fileContentInitialOffset;
-			const allocatedFileEntries = fileEntries
-				.map(({ fileName, content }) => {
-					if (fileContentOffset + content.length > PAGE_SIZE) {
-						nextPageNumber++;
-						fileContentOffset = 0;
-					}
-					
-					const entry = {
-						fileName,
-						pageNumber: nextPageNumber,
-						offset: fileContentOffset,
-						contentLength: content.length,
-						content
-					};
-
-					fileContentOffset += content.length;
-					
-					return entry;
-				});
+			const obj = that.generateObj(project);
 
-			const fileEntriesTable = allocatedFileEntries
-				.map(({ fileName, pageNumber, offset, content }) => {
-					const entry = [
-						...stringToPaddedByteArray(fileName, fileEntryFormat.name),
-						...toBytePair(pageNumber),
-						...toBytePair(content.length),
-						...toBytePair(offset)
-					];
-					
-					return entry;
-				});
-				
-			const pages = [
-				[...header, ..._.flatten(fileEntriesTable)]
-			];
-			allocatedFileEntries.forEach(({ fileName, pageNumber, offset, content }) => {
-				const pageIndex = pageNumber - INITIAL_PAGE;
-				const pageData = pages[pageIndex] || [];
-				
-				if (pageData.length < PAGE_SIZE) {
-					pageData.length = PAGE_SIZE;
-					for (let idx = 0; idx < PAGE_SIZE; idx++) {
-						pageData[idx] = pageData[idx] || 0;
-					}
-				}
-				
-				content.forEach((byte, idx) => {
-					pageData[offset + idx] = byte;
+			return packFiles([
+				...Object.entries(that.generateTileSetFiles(obj)).map(([fileName, content]) => contentFile(fileName, content)),
+				...obj.maps
+			]);
+		},
+
+		/**
+		 * Builds the resource image from a map of file names to their contents.
+		 */
+		packInternalFileSystem: (internalFiles) => packFiles(Object.entries(internalFiles).map(([fileName, content]) => contentFile(fileName, content))),
+
+		/**
+		 * Same as generateInternalFileSystem(), for a base ROM of LEGACY_FORMAT_VERSION.
+		 */
+		generateLegacyInternalFileSystem: (project) => {
+			const { mapWidth, mapHeight } = project.options;
+			if (mapWidth * mapHeight > LEGACY_MAX_MAP_CELLS) {
+				throw new Error(`Maps are ${mapWidth}x${mapHeight} tiles; the base ROM can only show up to ${LEGACY_MAX_MAP_CELLS} tiles, ` +
+					'it has to be rebuilt from the sources on base-rom.');
+			}
+
+			const obj = that.generateObj(project);
+			const { tileSetSize } = obj;
+
+			const paddedPalette = new Uint8Array(Math.max(16, obj.palette.length));
+			paddedPalette.set(obj.palette);
+
+			// Tile count, then a result for each pair of source and dest tiles
+			const combinations = new Uint8Array(2 + tileSetSize * tileSetSize);
+			new ByteWriter(combinations).u16(tileSetSize);
+			project.tileSet.combinations
+				.filter(({ sourceTile, destTile, resultTile }) => resultTile && sourceTile <= tileSetSize && destTile <= tileSetSize)
+				.forEach(({ sourceTile, destTile, resultTile }) => {
+					combinations[2 + (sourceTile - 1) * tileSetSize + (destTile - 1)] = resultTile;
 				});
-				
-				pages[pageIndex] = pageData;
+
+			const maps = project.maps.map(({ id, name, tileIndexes }, idx) => {
+				const content = new Uint8Array(MAP_HEADER_SIZE + mapWidth * mapHeight);
+				new ByteWriter(content)
+					.u16(id)
+					.u16(mapWidth)
+					.u16(mapHeight)
+					.string(name, 32)
+					.copy(flattenTileIndexes(tileIndexes, mapWidth, mapHeight));
+				return contentFile(levelFileName(idx + 1), content);
 			});
-			
-			return _.flatten(pages);
+
+			return packLegacyFiles([
+				contentFile('main.pal', paddedPalette),
+				contentFile('main.til', obj.rawTileSet),
+				contentFile('main.atr', obj.tileAttributes),
+				contentFile('project.inf', obj.projectInfo),
+				contentFile('merging.dat', combinations),
+				...maps
+			]);
 		},
-		
+
 		generateBlob: (project) => {
-			const obj = that.generateObj(project);
-			
-			const arrays = [
-				that.generateInternalFileSystem(project)
-			].map(a => new Uint8Array(a));
-			
-			return new Blob(arrays, { type: 'application/octet-stream' });
+			return new Blob([that.generateInternalFileSystem(project)], { type: 'application/octet-stream' });
 		},
-		
+
+		/**
+		 * Returns the resource format version the base ROM reads, from the tag it carries, or LEGACY_FORMAT_VERSION without one.
+		 */
+		getBaseROMFormat: (baseROM) => {
+			const prefix = Uint8Array.from(BASE_ROM_FORMAT_TAG_PREFIX, c => c.charCodeAt(0));
+			for (let start = baseROM.indexOf(prefix[0]); start >= 0; start = baseROM.indexOf(prefix[0], start + 1)) {
+				if (!prefix.every((b, idx) => baseROM[start + idx] === b)) continue;
+
+				let version = 0, position = start + prefix.length;
+				for (; baseROM[position] >= 0x30 && baseROM[position] <= 0x39; position++) version = version * 10 + baseROM[position] - 0x30;
+				if (position > start + prefix.length && !baseROM[position]) return version;
+			}
+
+			return LEGACY_FORMAT_VERSION;
+		},
+
+		/**
+		 * Throws if the base ROM can't read the resources generated by generateInternalFileSystem().
+		 */
+		checkBaseROM: (baseROM) => {
+			if (that.getBaseROMFormat(baseROM) !== RESOURCE_FORMAT_VERSION) {
+				throw new Error(`The base ROM doesn't read resource format ${RESOURCE_FORMAT_VERSION}; ` +
+					'it has to be rebuilt from the sources on base-rom.');
+			}
+		},
+
+		// Errors while generating the resource also come out of the promise
 		generateROM: (project) => {
-			const resourceToAppend = that.generateBlob(project);
-			
 			return fetch('base-rom/dist/puzzle_maker_base_rom.sms', {
 				method: 'GET',
 				headers: {
@@ -210,14 +770,22 @@
 				},
 				responseType: 'arraybuffer'
 			})
-			.then(response => response.blob())
+			.then(response => response.arrayBuffer())
 			.then(baseROM => {
-				return new Blob([baseROM, resourceToAppend], { type: 'application/octet-stream' });
+				// The base ROM on base-rom/dist may predate the current format; it still gets a resource it can read
+				const format = that.getBaseROMFormat(new Uint8Array(baseROM));
+				if (format === LEGACY_FORMAT_VERSION) {
+					console.warn('The base ROM predates the versioned resource format; the resource is written in the legacy format.');
+					return new Blob([baseROM, that.generateLegacyInternalFileSystem(project)], { type: 'application/octet-stream' });
+				}
+
+				that.checkBaseROM(new Uint8Array(baseROM));
+				return new Blob([baseROM, that.generateBlob(project)], { type: 'application/octet-stream' });
 			});
 		}
-		
+
 	};
-	
+
 	window.gameResource = that;
-	
-})();
\ No newline at end of file
+
+})();
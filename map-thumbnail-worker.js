@@ -0,0 +1,48 @@
+'use strict';
+
+/**
+ * Draws the map thumbnails for the map list.
+ * Loaded as a worker, it renders them on an OffscreenCanvas and sends them back as PNG blobs;
+ * loaded as a regular script, it only provides drawMapThumbnail(), for browsers where the worker can't run.
+ */
+
+/**
+ * Draws a map, given as a flat array of tile indexes, on the given 2D context.
+ * Tile index 0 is empty; the others are counted from the top left of the tileset, left to right.
+ */
+const drawMapThumbnail = (ctx, tileSet, tileSize, { width, height, tiles }) => {
+	const tilesPerRow = Math.ceil(tileSet.width / tileSize);
+
+	ctx.clearRect(0, 0, width * tileSize, height * tileSize);
+	for (let row = 0; row < height; row++) {
+		for (let col = 0; col < width; col++) {
+			const tileIndex = tiles[row * width + col];
+			if (!tileIndex) continue;
+
+			const srcCol = (tileIndex - 1) % tilesPerRow;
+			const srcRow = Math.floor((tileIndex - 1) / tilesPerRow);
+			ctx.drawImage(tileSet, srcCol * tileSize, srcRow * tileSize, tileSize, tileSize, col * tileSize, row * tileSize, tileSize, tileSize);
+		}
+	}
+};
+
+if (typeof WorkerGlobalScope !== 'undefined' && self instanceof WorkerGlobalScope) {
+	let tileSet = null;
+	let tileSize = 16;
+
+	self.addEventListener('message', ({ data }) => {
+		if (data.type === 'tileSet') {
+			if (tileSet) tileSet.close();
+			({ tileSet, tileSize } = data);
+			return;
+		}
+
+		const { id, width, height } = data;
+		const canvas = new OffscreenCanvas(width * tileSize, height * tileSize);
+		if (tileSet) drawMapThumbnail(canvas.getContext('2d'), tileSet, tileSize, data);
+
+		canvas.convertToBlob()
+			.then(blob => self.postMessage({ id, blob }))
+			.catch(e => self.postMessage({ id, error: String(e) }));
+	});
+}
@@ -0,0 +1,251 @@
+'use strict';
+
+(() => {
+
+	const WORKER_URL = 'map-thumbnail-worker.js';
+
+	// Thumbnails this far outside of the visible area are rendered in advance
+	const PRELOAD_MARGIN = '256px';
+
+	/**
+	 * Hashes the map size and its tiles; two 32 bit FNV-1a hashes with different seeds,
+	 * so that a stale thumbnail needs both of them to collide.
+	 */
+	const hashTiles = ({ width, height, tiles }) => {
+		let h1 = 0x811C9DC5;
+		let h2 = 0x01000193 ^ 0x5BD1E995;
+		const mix = n => {
+			h1 = Math.imul(h1 ^ n, 0x01000193);
+			h2 = Math.imul(h2 ^ n, 0x01000193) ^ (h2 >>> 15);
+		};
+
+		mix(width);
+		mix(height);
+		tiles.forEach(mix);
+
+		return (h1 >>> 0).toString(16).padStart(8, '0') + (h2 >>> 0).toString(16).padStart(8, '0');
+	};
+
+	// Missing rows and tiles are treated as empty, same as the editor does when it loads a map
+	const flattenTiles = (tileIndexes, width, height) => {
+		const tiles = new Uint16Array(width * height);
+		for (let row = 0; row < height; row++) {
+			const tilesRow = tileIndexes && tileIndexes[row];
+			if (!tilesRow) continue;
+			for (let col = 0; col < width; col++) tiles[row * width + col] = tilesRow[col] || 0;
+		}
+		return tiles;
+	};
+
+	/**
+	 * Keeps the rendered thumbnails as object URLs, indexed by a hash of the map's contents,
+	 * so that redrawing the map list only renders the maps that changed, and only once they're about to be visible.
+	 */
+	const create = () => {
+		const cache = new Map();
+		const pending = new Map();
+		const jobs = new WeakMap();
+
+		let tileSet = null;
+		let generation = 0;
+
+		let observer = null;
+
+		let worker = null;
+		let workerFailed = false;
+		let workerTileSet = null;
+		let nextRequestId = 1;
+		const workerRequests = new Map();
+
+		const failWorker = e => {
+			console.warn('Map thumbnails will be rendered on the main thread', e);
+			workerFailed = true;
+			if (worker) worker.terminate();
+			worker = null;
+
+			workerRequests.forEach(({ reject }) => reject(e));
+			workerRequests.clear();
+		};
+
+		const startWorker = () => {
+			if (worker || workerFailed) return worker;
+
+			if (typeof OffscreenCanvas === 'undefined' || typeof createImageBitmap === 'undefined') {
+				workerFailed = true;
+				return null;
+			}
+
+			try {
+				worker = new Worker(WORKER_URL);
+			} catch (e) {
+				// Browsers may refuse to start workers for pages opened from the file system
+				failWorker(e);
+				return null;
+			}
+
+			worker.addEventListener('message', ({ data: { id, blob, error } }) => {
+				const request = workerRequests.get(id);
+				if (!request) return;
+
+				workerRequests.delete(id);
+				if (error) {
+					request.reject(new Error(error));
+				} else {
+					request.resolve(blob);
+				}
+			});
+			worker.addEventListener('error', e => {
+				e.preventDefault();
+				failWorker(e.message || e);
+			});
+
+			return worker;
+		};
+
+		// The tileset is sent to the worker once for each time it changes, before any map that uses it
+		const sendTileSetToWorker = () => {
+			if (workerTileSet && workerTileSet.generation === generation) return workerTileSet.ready;
+
+			const tileSetGeneration = generation;
+			const { image, tileSize } = tileSet;
+			const ready = createImageBitmap(image).then(bitmap => {
+				if (!worker || tileSetGeneration !== generation) {
+					bitmap.close();
+					return;
+				}
+				worker.postMessage({ type: 'tileSet', tileSet: bitmap, tileSize }, [bitmap]);
+			});
+
+			workerTileSet = { generation: tileSetGeneration, ready };
+			return ready;
+		};
+
+		const renderOnWorker = job => sendTileSetToWorker().then(() => new Promise((resolve, reject) => {
+			if (!worker) throw new Error('The thumbnail worker has stopped');
+
+			const id = nextRequestId++;
+			workerRequests.set(id, { resolve, reject });
+			worker.postMessage({ type: 'render', id, width: job.width, height: job.height, tiles: job.tiles });
+		}));
+
+		const renderOnMainThread = job => new Promise((resolve, reject) => {
+			const { image, tileSize } = tileSet;
+
+			const canvas = document.createElement('canvas');
+			canvas.width = job.width * tileSize;
+			canvas.height = job.height * tileSize;
+			drawMapThumbnail(canvas.getContext('2d'), image, tileSize, job);
+
+			canvas.toBlob(blob => blob ? resolve(blob) : reject(new Error("Couldn't render the map thumbnail")));
+		});
+
+		// Maps with the same contents share the same rendering, even when several are requested at once
+		const render = job => {
+			if (cache.has(job.key)) return Promise.resolve(cache.get(job.key));
+			if (pending.has(job.key)) return pending.get(job.key);
+
+			const renderGeneration = generation;
+			const blobPromise = startWorker()
+				? renderOnWorker(job).catch(() => renderOnMainThread(job))
+				: renderOnMainThread(job);
+
+			const urlPromise = blobPromise.then(blob => {
+				const url = URL.createObjectURL(blob);
+				if (renderGeneration === generation) {
+					cache.set(job.key, url);
+				} else {
+					// Rendered with a tileset that's no longer in use
+					window.setTimeout(() => URL.revokeObjectURL(url), 0);
+				}
+				return url;
+			}).finally(() => pending.delete(job.key));
+			pending.set(job.key, urlPromise);
+
+			return urlPromise;
+		};
+
+		const showThumbnail = (img, url) => {
+			img.src = url;
+			img.classList.remove('loading');
+		};
+
+		const renderThumbnail = img => {
+			const job = jobs.get(img);
+			if (!job) return;
+
+			render(job)
+				.then(url => {
+					if (jobs.get(img) === job) showThumbnail(img, url);
+				})
+				.catch(e => console.error('Error rendering the map thumbnail', e));
+		};
+
+		const observe = img => {
+			if (typeof IntersectionObserver === 'undefined') {
+				renderThumbnail(img);
+				return;
+			}
+
+			if (!observer) {
+				observer = new IntersectionObserver(entries => entries
+					.filter(({ isIntersecting }) => isIntersecting)
+					.forEach(({ target }) => {
+						observer.unobserve(target);
+						renderThumbnail(target);
+					}), { rootMargin: PRELOAD_MARGIN });
+			}
+			observer.observe(img);
+		};
+
+		const that = {
+
+			/**
+			 * Must be called whenever the tileset image changes; all thumbnails are rendered again after that.
+			 */
+			setTileSet: (image, tileSize) => {
+				tileSet = { image, tileSize };
+				generation++;
+
+				cache.forEach(url => URL.revokeObjectURL(url));
+				cache.clear();
+				pending.clear();
+			},
+
+			/**
+			 * Assigns thumbnails to the given image elements, each one with the tileIndexes of its map;
+			 * these replace any images given before.
+			 */
+			update: (entries, width, height) => {
+				if (observer) observer.disconnect();
+				if (!tileSet) return;
+
+				const keysInUse = new Set();
+				entries.forEach(({ img, tileIndexes }) => {
+					const job = { width, height, tiles: flattenTiles(tileIndexes, width, height) };
+					job.key = `${generation}.${hashTiles(job)}`;
+					keysInUse.add(job.key);
+					jobs.set(img, job);
+
+					if (cache.has(job.key)) {
+						showThumbnail(img, cache.get(job.key));
+					} else {
+						observe(img);
+					}
+				});
+
+				// Thumbnails for maps that changed, or were deleted, won't be needed anymore
+				cache.forEach((url, key) => {
+					if (keysInUse.has(key)) return;
+					URL.revokeObjectURL(url);
+					cache.delete(key);
+				});
+			}
+
+		};
+
+		return that;
+	};
+
+	window.mapThumbnails = { create, hashTiles };
+
+})();
@@ -1,6 +1,10 @@
 var tinyMapEditor = (function() {
 	const APP_NAME = 'SMS-Puzzle-Maker';
 	const APP_VERSION = '0.21.0';	
+	
+	// Same as MAP_MAX_W, MAP_MAX_H and MAP_MAX_CELLS on the base ROM; maps bigger than 16x9 will scroll.
+	const MAX_MAP_SIZE = 64;
+	const MAX_MAP_CELLS = 2048;
 
     var win = window,
         doc = document,
@@ -53,6 +57,7 @@ var tinyMapEditor = (function() {
         addMap = getById('addMap'),
         deleteMap = getById('deleteMap'),
 		mapList = getById('mapList'),
+		thumbnails = mapThumbnails.create(),
 		
 		generateResource = getById('generateResource'),
 		generateROM = getById('generateROM');
@@ -248,11 +253,11 @@ var tinyMapEditor = (function() {
 		
 		drawMapList: function() {
 			mapList.innerHTML = maps.listAll()
-				.map(({ name, id, tileIndexes }) => {
+				.map(({ name, id }) => {
 					return '<p><label>' +
 						`<input type="radio" name="selectedMap" value="${id}" ${id === mapId ? 'checked' : ''} />` + 
 						name +
-						`<image class="thumbnail loading" data-tme-tile="${JSON.stringify(tileIndexes)}" />` +
+						`<img class="thumbnail loading" data-tme-map-id="${id}" />` +
 					'</label></p>';
 				})
 				.join('\n');
@@ -261,20 +266,12 @@ var tinyMapEditor = (function() {
 		},
 		
 		generateThumbnails: function() {
-			[...document.querySelectorAll("#mapList .thumbnail")].forEach(thumbnail => {
-				window.setTimeout(() => {
-					const tileIndexes = JSON.parse(thumbnail.dataset.tmeTile);
-					
-					const canvas = document.createElement('canvas');
-					canvas.width = width * tileSize;
-					canvas.height = height * tileSize;
-					
-					this.prepareMapTiles(tileIndexes);
-					this.loadMapIntoContext(tileIndexes, canvas.getContext('2d'));
-					
-					thumbnail.src = canvas.toDataURL();
-				}, 0);
-			});
+			const mapsById = new Map(maps.listAll().map(m => [m.id, m]));
+			
+			thumbnails.update([...mapList.querySelectorAll('.thumbnail')].map(img => ({
+				img,
+				tileIndexes: mapsById.get(+img.dataset.tmeMapId).tileIndexes
+			})), width, height);
 		},
 			
 		addNewMap: function(e) {
@@ -394,17 +391,28 @@ var tinyMapEditor = (function() {
         },
 
         buildGameResource : function(e) {
-			const project = this.generateProjectObject();
-			const blob = gameResource.generateBlob(project);
+			try {
+				const project = this.generateProjectObject();
+				const blob = gameResource.generateBlob(project);
 
-			saveAs(blob, APP_NAME + '.resource.bin');
+				saveAs(blob, APP_NAME + '.resource.bin');
+			} catch (e) {
+				const prefix = 'Error while generating the resource';
+				console.error(prefix, e);
+				alert(prefix + ': ' + e);
+			}
         },
 
         buildGameROM : function(e) {
 			const project = this.generateProjectObject();
 			
 			gameResource.generateROM(project)
-			.then(blob => saveAs(blob, this.getProjectFileName(project) + '.sms'));
+			.then(blob => saveAs(blob, this.getProjectFileName(project) + '.sms'))
+			.catch(e => {
+				const prefix = 'Error while generating the ROM';
+				console.error(prefix, e);
+				alert(prefix + ': ' + e);
+			});
         },
 
         sortPartial : function(arr) {
@@ -429,11 +437,11 @@ var tinyMapEditor = (function() {
 			this.prepareMapTiles(tiles);
 		},
 		
+		// Only pads: cells outside of the map size are kept, so that making the map smaller by mistake loses nothing.
+		// The generator only encodes the cells inside of the map size.
 		prepareMapTiles : function(mapTiles) {
-			mapTiles.length = height;
 			for (let row = 0; row < height; row++) {
 				const tilesRow = mapTiles[row] || [];
-				tilesRow.length = width;
 				for (let col = 0; col < width; col++) {
 					tilesRow[col] = tilesRow[col] || 0;
 				}
@@ -689,6 +697,7 @@ var tinyMapEditor = (function() {
 			if (!projectInfo) projectInfo = {};
 			
 			projectInfo.name = projectInfo.name || 'Unnamed Project';
+			projectInfo.compressTileSet = !!projectInfo.compressTileSet;
 		},
 		
         saveProjectInfo : function() {			
@@ -703,7 +712,7 @@ var tinyMapEditor = (function() {
 		showProjectInfoPopup : function() {
 			this.prepareProjectInfoStructure();
 			
-			const { h, newDiv, newLabel, newInput, newDataInput, populateModalDialog } = DomUtil;
+			const { h, newDiv, newLabel, newInput, newDataInput, newDataCheckbox, populateModalDialog } = DomUtil;
 
 			const handleChange = result => {
 				this.saveProjectInfo();
@@ -713,6 +722,10 @@ var tinyMapEditor = (function() {
 				newDiv(
 					newLabel('Project Name:'),
 					newDataInput(projectInfo, 'name', 'text', { '@afterchange': handleChange })
+				),
+				newDiv(
+					newLabel('Compress tileset (PSGaiden):'),
+					newDataCheckbox(projectInfo, 'compressTileSet', { '@afterclick': handleChange })
 				)
 			);
 		},
@@ -800,8 +813,12 @@ var tinyMapEditor = (function() {
 		updateSizeVariables : function() {
 			const inputToNumber = el => +el.value || 1;
 			
-			width = 16;
-			height = 9;
+			const inputToMapSize = el => Math.min(inputToNumber(el), MAX_MAP_SIZE);
+			
+			width = inputToMapSize(widthInput);
+			height = Math.min(inputToMapSize(heightInput), Math.floor(MAX_MAP_CELLS / width));
+			widthInput.value = width;
+			heightInput.value = height;
 			tileSize = 16;
 			tileZoom = inputToNumber(tileZoomInput);
 
@@ -893,6 +910,7 @@ var tinyMapEditor = (function() {
 					forMasterSystem: tileSetForSms
 				});
 
+				thumbnails.setTileSet(sprite, tileSize);
 				_this.loadMap();
             }, false);
 